@@ -0,0 +1,157 @@
+// append_state.cpp
+#include "append_state.h"
+#include "sparse_index.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const MAGIC = "MDMSTATE3";
+
+bool seekInput(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+} // namespace
+
+std::string AppendState::pathFor(const std::string& outputFile) {
+    return outputFile + ".state";
+}
+
+bool AppendState::load(const std::string& outputFile) {
+    inputs.clear();
+    uint64_t size;
+    int64_t mtime;
+    std::ifstream in(pathFor(outputFile));
+    std::string magic;
+    if (!in || !std::getline(in, magic) || magic != MAGIC || !SparseIndex::stat(outputFile, size, mtime)) return false;
+
+    int typedFlag = 0;
+    int dedupFlag = 0;
+    size_t count = 0;
+    if (!std::getline(in, columns) ||
+        !(in >> outputSize >> outputMtime >> window.from >> window.to >> typedFlag >> dedupFlag >> conflateNanos) ||
+        !(in >> count)) {
+        return false;
+    }
+    typed = typedFlag != 0;
+    dedup = dedupFlag != 0;
+    symbols.assign(count, std::string());
+    for (std::string& symbol : symbols) {
+        if (!(in >> symbol)) return false;
+    }
+    std::sort(symbols.begin(), symbols.end());
+    if (!(in >> count)) return false;
+    for (size_t i = 0; i < count; ++i) {
+        std::string symbol;
+        uint64_t bytes;
+        if (!(in >> bytes >> symbol)) return false;
+        inputs.emplace_back(std::move(symbol), bytes);
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return outputSize == size && outputMtime == mtime;
+}
+
+bool AppendState::save(const std::string& outputFile) {
+    if (!SparseIndex::stat(outputFile, outputSize, outputMtime)) return false;
+    std::ostringstream text;
+    text << MAGIC << "\n"
+         << columns << "\n"
+         << outputSize << " " << outputMtime << "\n"
+         << window.from << " " << window.to << " " << (typed ? 1 : 0) << " " << (dedup ? 1 : 0) << " " << conflateNanos
+         << "\n"
+         << symbols.size();
+    for (const std::string& symbol : symbols) text << " " << symbol;
+    text << "\n" << inputs.size() << "\n";
+    for (const auto& input : inputs) text << input.second << " " << input.first << "\n";
+
+    std::string path = pathFor(outputFile);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out << text.str();
+        if (!out.flush()) return false;
+    }
+    std::error_code error;
+    fs::rename(temp, path, error);
+    return !error;
+}
+
+uint64_t AppendState::mergedBytes(std::string_view symbol) const {
+    auto it = std::lower_bound(inputs.begin(), inputs.end(), symbol,
+                               [](const std::pair<std::string, uint64_t>& input, std::string_view s) { return input.first < s; });
+    return it != inputs.end() && it->first == symbol ? it->second : 0;
+}
+
+void AppendState::setMergedBytes(const std::string& symbol, uint64_t bytes) {
+    auto it = std::lower_bound(inputs.begin(), inputs.end(), symbol,
+                               [](const std::pair<std::string, uint64_t>& input, const std::string& s) { return input.first < s; });
+    if (it != inputs.end() && it->first == symbol) it->second = bytes;
+    else inputs.emplace(it, symbol, bytes);
+}
+
+bool readLastRow(const std::string& outputFile, std::string& line) {
+    std::error_code error;
+    uint64_t size = fs::file_size(outputFile, error);
+    std::FILE* file = error ? nullptr : std::fopen(outputFile.c_str(), "rb");
+    if (!file) return false;
+
+    // Read backwards a block at a time until the line before the last one has ended
+    const uint64_t block = 4096;
+    std::string tail;
+    uint64_t start = size;
+    size_t lineStart = std::string::npos;
+    while (start > 0) {
+        uint64_t from = start > block ? start - block : 0;
+        std::string chunk(static_cast<size_t>(start - from), '\0');
+        if (!seekInput(file, from) || std::fread(&chunk[0], 1, chunk.size(), file) != chunk.size()) break;
+        tail.insert(0, chunk);
+        start = from;
+        size_t end = tail.size();
+        while (end > 0 && (tail[end - 1] == '\n' || tail[end - 1] == '\r')) --end;
+        size_t newline = end > 0 ? tail.rfind('\n', end - 1) : std::string::npos;
+        if (newline != std::string::npos) {
+            lineStart = newline + 1;
+            tail.resize(end);
+            break;
+        }
+    }
+    std::fclose(file);
+    if (lineStart == std::string::npos) return false; // Empty, or nothing but the header
+
+    line = tail.substr(lineStart);
+    return true;
+}
+
+uint64_t completeLinesEnd(const std::string& path, uint64_t size) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return 0;
+    const uint64_t block = 4096;
+    std::vector<char> chunk(block);
+    uint64_t start = size;
+    uint64_t end = 0;
+    while (start > 0 && end == 0) {
+        uint64_t from = start > block ? start - block : 0;
+        size_t bytes = static_cast<size_t>(start - from);
+        if (!seekInput(file, from) || std::fread(chunk.data(), 1, bytes, file) != bytes) break;
+        for (size_t i = bytes; i > 0; --i) {
+            if (chunk[i - 1] == '\n') {
+                end = from + i;
+                break;
+            }
+        }
+        start = from;
+    }
+    std::fclose(file);
+    return end;
+}
@@ -0,0 +1,49 @@
+// append_state.h
+#ifndef APPEND_STATE_H
+#define APPEND_STATE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "merge_key.h"
+
+// What an --append merge needs to know about the output it extends: how many bytes of each input
+// it holds, and the settings that shaped it. Kept as a "<output_file>.state" text file next to the
+// output and only trusted while the output still has the size and mtime recorded in it.
+struct AppendState {
+    uint64_t outputSize = 0;
+    int64_t outputMtime = 0;
+    TimeRange window;
+    bool typed = false;
+    bool dedup = false;
+    int64_t conflateNanos = 0;
+    std::vector<std::string> symbols; // --symbols filter, sorted (empty = all)
+    std::string columns;              // Schema::COLUMNS of the output
+    std::vector<std::pair<std::string, uint64_t>> inputs; // Symbol and input bytes merged, sorted by symbol
+
+    static std::string pathFor(const std::string& outputFile);
+
+    // Loads the state of 'outputFile'; false if it is missing, damaged or the output changed since
+    bool load(const std::string& outputFile);
+
+    // Records the current size and mtime of 'outputFile' and writes the state (temp file + rename)
+    bool save(const std::string& outputFile);
+
+    // Bytes of the input for 'symbol' already in the output (0 for an input not seen before)
+    uint64_t mergedBytes(std::string_view symbol) const;
+
+    // Sets the merged bytes of 'symbol', keeping 'inputs' sorted
+    void setMergedBytes(const std::string& symbol, uint64_t bytes);
+};
+
+// Last line of a CSV file (a merged output or a plain input), without its line end; false if it has
+// no data rows
+bool readLastRow(const std::string& outputFile, std::string& line);
+
+// End of the last complete line in the first 'size' bytes of a plain file: the offset just past
+// its newline, or 0 if there is none. A row a feed is still writing ends after it.
+uint64_t completeLinesEnd(const std::string& path, uint64_t size);
+
+#endif // APPEND_STATE_H
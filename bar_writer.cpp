@@ -0,0 +1,63 @@
+// bar_writer.cpp
+#include "bar_writer.h"
+#include <algorithm>
+
+bool BarWriter::open(const std::string& path, size_t bufferSize) {
+    if (!out_.open(path, bufferSize)) return false;
+    out_.write("Symbol,Timestamp,Open,High,Low,Close,Volume\n"); // Write header
+    bars_.assign(symbols_.size(), Bar());
+    active_.clear();
+    return true;
+}
+
+void BarWriter::write(const ColumnBatch& batch) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (!isTrade(batch.types[i])) continue;
+        int64_t interval = timeBucket(batch.timestamps[i], interval_);
+        if (interval != current_) {
+            writeInterval();
+            current_ = interval;
+        }
+        int64_t price = batch.prices[i];
+        Bar& bar = bars_[batch.symbols[i]];
+        if (!bar.active) {
+            bar = Bar{price, price, price, price, 0, true};
+            active_.push_back(batch.symbols[i]);
+        }
+        bar.high = std::max(bar.high, price);
+        bar.low = std::min(bar.low, price);
+        bar.close = price;
+        bar.volume += batch.sizes[i];
+    }
+}
+
+bool BarWriter::close() {
+    writeInterval();
+    return out_.close();
+}
+
+bool BarWriter::isTrade(uint32_t type) {
+    while (isTrade_.size() <= type) isTrade_.push_back(types_.name(static_cast<uint32_t>(isTrade_.size())) == TRADE_TYPE);
+    return isTrade_[type] != 0;
+}
+
+void BarWriter::writeInterval() {
+    std::sort(active_.begin(), active_.end());
+    for (uint32_t symbol : active_) {
+        Bar& bar = bars_[symbol];
+        line_.clear();
+        line_ += symbols_.name(symbol);
+        line_ += ',';
+        formatTimestamp(current_ * interval_, line_);
+        for (int64_t price : {bar.open, bar.high, bar.low, bar.close}) {
+            line_ += ',';
+            formatPrice(price, line_);
+        }
+        line_ += ',';
+        line_ += std::to_string(bar.volume);
+        line_ += '\n';
+        out_.write(line_);
+        bar.active = false;
+    }
+    active_.clear();
+}
@@ -0,0 +1,54 @@
+// bar_writer.h
+#ifndef BAR_WRITER_H
+#define BAR_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "buffered_sink.h"
+#include "column_batch.h"
+#include "market_record.h"
+#include "merge_key.h"
+
+// Type of the rows bars are built from; quotes carry no traded volume
+const char* const TRADE_TYPE = "TRADE";
+
+// Rolls merged column batches up into OHLCV bars instead of writing the ticks: one
+// "Symbol,Timestamp,Open,High,Low,Close,Volume" row per symbol and interval with trades, stamped
+// with the interval start. Batches arrive in time order, so an interval is complete once a later
+// one begins; its bars are then written by symbol id, keeping the output in (Timestamp, Symbol) order.
+class BarWriter {
+public:
+    BarWriter(const SymbolTable& symbols, const FieldDictionary& types, int64_t intervalNanos)
+        : symbols_(symbols), types_(types), interval_(intervalNanos) {}
+
+    bool open(const std::string& path, size_t bufferSize = BufferedSink::DEFAULT_BUFFER_SIZE);
+    void write(const ColumnBatch& batch);
+    bool close(); // Writes the bars of the last interval
+    const BufferedSink& sink() const { return out_; }
+
+private:
+    struct Bar {
+        int64_t open;
+        int64_t high;
+        int64_t low;
+        int64_t close;
+        uint64_t volume;
+        bool active; // Has trades in the current interval
+    };
+
+    const SymbolTable& symbols_;
+    const FieldDictionary& types_;
+    int64_t interval_;
+    int64_t current_ = 0;          // Interval of the bars being built
+    std::vector<Bar> bars_;        // Running state, indexed by symbol id
+    std::vector<uint32_t> active_; // Symbols with a bar in the current interval
+    std::vector<char> isTrade_;    // By type id, filled as the dictionary grows
+    BufferedSink out_;
+    std::string line_;             // Scratch for one formatted row
+
+    bool isTrade(uint32_t type);
+    void writeInterval();
+};
+
+#endif // BAR_WRITER_H
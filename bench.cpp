@@ -0,0 +1,221 @@
+// bench.cpp
+// merger_bench: generates synthetic per-symbol tick files and times each merge engine on them.
+#include "market_data_merger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if !defined(__linux__) && !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct GeneratorConfig {
+    size_t symbols = 1000;       // Number of per-symbol files (10 to 50k)
+    size_t rowsPerSymbol = 1000;
+    double skewMillis = 1000;    // Each symbol starts at a random offset in [0, skew)
+    double duplicateRate = 0.1;  // Probability that a row repeats the previous row's timestamp
+    unsigned seed = 42;
+};
+
+// A named merger configuration to benchmark
+struct Engine {
+    const char* name;
+    MergeOptions options;
+};
+
+std::vector<Engine> allEngines() {
+    std::vector<Engine> engines;
+    MergeOptions options;
+    engines.push_back({"loser-tree", options});
+
+    options = MergeOptions();
+    options.kernel = MergeKernel::Heap;
+    engines.push_back({"heap", options});
+
+    options = MergeOptions();
+    options.io = IoMode::Mmap;
+    engines.push_back({"mmap", options});
+
+    options = MergeOptions();
+    options.threads = 4;
+    engines.push_back({"parallel", options});
+
+    options = MergeOptions();
+    options.partitions = 4;
+    engines.push_back({"partitioned", options});
+
+    options = MergeOptions();
+    options.prefetchThreads = 2;
+    engines.push_back({"prefetch", options});
+    return engines;
+}
+
+// Symbol names "AAAA", "AAAB", ... so file names are unique and alphabetic like real tickers
+std::string symbolName(size_t index) {
+    std::string name(4, 'A');
+    for (size_t pos = name.size(); pos-- > 0 && index > 0; index /= 26) {
+        name[pos] = static_cast<char>('A' + index % 26);
+    }
+    return name;
+}
+
+void appendTimestamp(std::string& out, int64_t millis) {
+    // All synthetic data lies on 2021-03-05 starting at 09:30:00.000
+    int64_t t = millis + (9 * 3600 + 30 * 60) * 1000LL;
+    char text[32];
+    std::snprintf(text, sizeof(text), "2021-03-05 %02d:%02d:%02d.%03d", static_cast<int>(t / 3600000 % 24),
+                  static_cast<int>(t / 60000 % 60), static_cast<int>(t / 1000 % 60), static_cast<int>(t % 1000));
+    out += text;
+}
+
+// Writes one file per symbol in the Timestamp,Price,Size,Exchange,Type format; returns total bytes
+uintmax_t generate(const GeneratorConfig& config, const std::string& dir) {
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    static const char* exchanges[] = {"NYSE", "NASDAQ", "NYSE_ARCA", "NSX", "BATS"};
+    static const char* types[] = {"Ask", "Bid", "TRADE"};
+    std::mt19937_64 rng(config.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    uintmax_t totalBytes = 0;
+    std::string text;
+
+    for (size_t s = 0; s < config.symbols; ++s) {
+        int64_t millis = static_cast<int64_t>(unit(rng) * config.skewMillis);
+        double price = 10 + unit(rng) * 490;
+        text = "Timestamp,Price,Size,Exchange,Type\n";
+        for (size_t r = 0; r < config.rowsPerSymbol; ++r) {
+            if (r > 0 && unit(rng) >= config.duplicateRate) millis += 1 + static_cast<int64_t>(rng() % 50);
+            price = std::max(0.01, price + (unit(rng) - 0.5) * 0.1);
+            appendTimestamp(text, millis);
+            char row[96];
+            std::snprintf(row, sizeof(row), ",%.2f,%u,%s,%s\n", price, static_cast<unsigned>(1 + rng() % 1000),
+                          exchanges[rng() % 5], types[rng() % 3]);
+            text += row;
+        }
+        std::ofstream out(dir + "/" + symbolName(s) + ".txt", std::ios::binary);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        totalBytes += text.size();
+    }
+    return totalBytes;
+}
+
+// Resets the peak-RSS counter so each engine reports its own peak (Linux only)
+void resetPeakRss() {
+#if defined(__linux__)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+// Peak resident set size in MiB since the last reset (process lifetime elsewhere)
+double peakRssMiB() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) return std::stod(line.substr(6)) / 1024.0;
+    }
+    return 0;
+#elif !defined(_WIN32)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [--symbols N] [--rows N] [--skew MS] [--dup-rate P] [--seed N] [--engines a,b,...]"
+                 " [--work-dir DIR] [--output FILE] [--keep-data]\n"
+              << "Engines:";
+    for (const auto& engine : allEngines()) std::cerr << " " << engine.name;
+    std::cerr << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    GeneratorConfig config;
+    std::string engineList;
+    std::string workDir = "bench_data";
+    std::string outputFile = "bench_output.txt";
+    bool keepData = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--symbols" && hasValue) config.symbols = std::stoul(argv[++i]);
+            else if (arg == "--rows" && hasValue) config.rowsPerSymbol = std::stoul(argv[++i]);
+            else if (arg == "--skew" && hasValue) config.skewMillis = std::stod(argv[++i]);
+            else if (arg == "--dup-rate" && hasValue) config.duplicateRate = std::stod(argv[++i]);
+            else if (arg == "--seed" && hasValue) config.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+            else if (arg == "--engines" && hasValue) engineList = argv[++i];
+            else if (arg == "--work-dir" && hasValue) workDir = argv[++i];
+            else if (arg == "--output" && hasValue) outputFile = argv[++i];
+            else if (arg == "--keep-data") keepData = true;
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Engine> engines;
+    for (const auto& engine : allEngines()) {
+        std::string name = std::string(",") + engine.name + ",";
+        if (engineList.empty() || ("," + engineList + ",").find(name) != std::string::npos) engines.push_back(engine);
+    }
+    if (engines.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string inputDir = workDir + "/input";
+    std::string tempDir = workDir + "/temp";
+    std::cout << "Generating " << config.symbols << " symbols x " << config.rowsPerSymbol << " rows..." << std::endl;
+    uintmax_t inputBytes = generate(config, inputDir);
+    double records = static_cast<double>(config.symbols) * static_cast<double>(config.rowsPerSymbol);
+    double inputMiB = static_cast<double>(inputBytes) / (1024.0 * 1024.0);
+    std::cout << "Input: " << records << " records, " << inputMiB << " MiB" << std::endl;
+
+    std::printf("%-12s %12s %10s %10s %8s %10s %10s %10s %7s\n", "engine", "records/s", "MiB/s", "seconds",
+                "peakMiB", "groupSec", "finalSec", "cleanSec", "passes");
+    for (const auto& engine : engines) {
+        fs::remove_all(tempDir);
+        fs::create_directories(tempDir);
+        resetPeakRss();
+
+        MarketDataMerger merger(inputDir, tempDir, outputFile, engine.options);
+        auto start = std::chrono::steady_clock::now();
+        if (!merger.merge()) std::cerr << engine.name << ": merge failed" << std::endl;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const MergeStats& stats = merger.stats();
+        std::printf("%-12s %12.0f %10.1f %10.3f %8.1f %10.3f %10.3f %10.3f %7zu\n", engine.name, records / seconds,
+                    inputMiB / seconds, seconds, peakRssMiB(), stats.groupMergeSeconds, stats.finalMergeSeconds,
+                    stats.cleanupSeconds, stats.passes);
+    }
+
+    if (!keepData) fs::remove_all(workDir);
+    return 0;
+}
@@ -0,0 +1,22 @@
+// buffer_arena.cpp
+#include "buffer_arena.h"
+
+BufferArena::BufferArena(size_t blocks, size_t blockSize)
+    : blocks_(blocks), blockSize_(blockSize), memory_(new char[blocks * blockSize]) {
+    // Pages are only touched when a block is first used, so an unused tail costs no memory
+    free_.reserve(blocks);
+    for (size_t i = blocks; i-- > 0;) free_.push_back(memory_.get() + i * blockSize);
+}
+
+char* BufferArena::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) return nullptr;
+    char* block = free_.back();
+    free_.pop_back();
+    return block;
+}
+
+void BufferArena::release(char* block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(block);
+}
@@ -0,0 +1,36 @@
+// buffer_arena.h
+#ifndef BUFFER_ARENA_H
+#define BUFFER_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Fixed-size blocks carved out of one allocation made up front. A merge sizes it from the number
+// of files it may hold open, so reader buffers are reused across groups and passes instead of
+// being allocated per file, and all of them are released in one step when the arena goes away.
+// Taking and returning blocks happens once per opened file, so a mutex is cheap enough.
+class BufferArena {
+public:
+    BufferArena(size_t blocks, size_t blockSize);
+
+    BufferArena(const BufferArena&) = delete;
+    BufferArena& operator=(const BufferArena&) = delete;
+
+    // A free block of blockSize() bytes, or nullptr when all are in use
+    char* acquire();
+    void release(char* block);
+
+    size_t blockSize() const { return blockSize_; }
+    size_t capacity() const { return blocks_; }
+
+private:
+    size_t blocks_;
+    size_t blockSize_;
+    std::unique_ptr<char[]> memory_;
+    std::vector<char*> free_;
+    std::mutex mutex_;
+};
+
+#endif // BUFFER_ARENA_H
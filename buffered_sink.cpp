@@ -0,0 +1,97 @@
+// buffered_sink.cpp
+#include "buffered_sink.h"
+#include <algorithm>
+#include <chrono>
+
+BufferedSink::~BufferedSink() {
+    close();
+}
+
+bool BufferedSink::open(const std::string& path, size_t bufferSize, bool checksummed) {
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+    std::setvbuf(file_, nullptr, _IONBF, 0); // Writes are already batched into large blocks
+
+    capacity_ = std::max<size_t>(bufferSize, 1);
+    buffers_[0].resize(capacity_);
+    buffers_[1].resize(capacity_);
+    active_ = 0;
+    used_ = 0;
+    pending_ = false;
+    stopping_ = false;
+    failed_ = false;
+    bytesWritten_ = stallNanos_ = 0;
+    checksummed_ = checksummed;
+    checksum_ = StreamChecksum();
+    writer_ = std::thread(&BufferedSink::writerLoop, this);
+    return true;
+}
+
+bool BufferedSink::close() {
+    if (!file_) return !failed_;
+    if (used_ > 0) submitActive();
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    writer_.join();
+    stallNanos_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    if (std::fclose(file_) != 0) failed_ = true;
+    file_ = nullptr;
+    buffers_[0] = std::vector<char>();
+    buffers_[1] = std::vector<char>();
+    capacity_ = used_ = 0;
+    return !failed_;
+}
+
+void BufferedSink::writeSlow(const char* data, size_t size) {
+    while (size > 0) {
+        if (used_ == capacity_) submitActive();
+        size_t chunk = std::min(size, capacity_ - used_);
+        std::memcpy(buffers_[active_].data() + used_, data, chunk);
+        used_ += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void BufferedSink::submitActive() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (pending_) {
+            auto start = std::chrono::steady_clock::now();
+            changed_.wait(lock, [this] { return !pending_; });
+            stallNanos_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+        pending_ = true;
+        pendingSize_ = used_;
+        active_ ^= 1; // The writer thread owns the other buffer until pending_ clears
+    }
+    changed_.notify_all();
+    bytesWritten_ += used_;
+    used_ = 0;
+}
+
+void BufferedSink::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        changed_.wait(lock, [this] { return pending_ || stopping_; });
+        if (!pending_) return; // Stopping with nothing left to write
+
+        const char* data = buffers_[active_ ^ 1].data();
+        size_t size = pendingSize_;
+        lock.unlock();
+        if (checksummed_) checksum_.update(data, size);
+        bool ok = std::fwrite(data, 1, size, file_) == size;
+        lock.lock();
+
+        if (!ok) failed_ = true;
+        pending_ = false;
+        changed_.notify_all();
+    }
+}
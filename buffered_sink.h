@@ -0,0 +1,88 @@
+// buffered_sink.h
+#ifndef BUFFERED_SINK_H
+#define BUFFERED_SINK_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "checksum.h"
+
+// Double-buffered file writer. The merge thread fills one fixed-size buffer while a dedicated
+// writer thread flushes the other with a single large write, so formatting never waits on I/O
+// unless both buffers are full.
+class BufferedSink {
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 4 << 20;
+
+    BufferedSink() = default;
+    ~BufferedSink();
+
+    BufferedSink(const BufferedSink&) = delete;
+    BufferedSink& operator=(const BufferedSink&) = delete;
+
+    // With 'checksummed', the writer thread also checksums what it writes (see checksum())
+    bool open(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE, bool checksummed = false);
+
+    void write(const char* data, size_t size) {
+        if (size <= capacity_ - used_) {
+            std::memcpy(buffers_[active_].data() + used_, data, size);
+            used_ += size;
+            return;
+        }
+        writeSlow(data, size);
+    }
+    void write(std::string_view text) { write(text.data(), text.size()); }
+    void put(char c) {
+        if (used_ == capacity_) submitActive();
+        buffers_[active_][used_++] = c;
+    }
+
+    // Hands buffered data to the writer thread without waiting for it to reach the file
+    void flush() {
+        if (used_ > 0) submitActive();
+    }
+
+    // Flushes everything, stops the writer thread and closes the file; false if any write failed
+    bool close();
+
+    // Counters since open(), kept after close(): bytes handed to the writer, and time the caller
+    // spent waiting for it
+    uint64_t bytesWritten() const { return bytesWritten_; }
+    uint64_t stallNanos() const { return stallNanos_; }
+
+    // Checksum of the bytes written since a checksummed open(); complete once close() returns
+    uint64_t checksum() const { return checksum_.value(); }
+
+private:
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffers_[2];
+    size_t capacity_ = 0;
+    size_t active_ = 0;    // Buffer being filled by the caller
+    size_t used_ = 0;      // Bytes used in the active buffer
+
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    size_t pendingSize_ = 0; // Bytes of the inactive buffer waiting to be written
+    bool pending_ = false;
+    bool stopping_ = false;
+    bool failed_ = false;
+    uint64_t bytesWritten_ = 0;
+    uint64_t stallNanos_ = 0;
+    bool checksummed_ = false;
+    StreamChecksum checksum_; // Fed by the writer thread only
+
+    void writeSlow(const char* data, size_t size);
+
+    // Hands the active buffer to the writer thread (waiting for the previous flush) and switches buffers
+    void submitActive();
+    void writerLoop();
+};
+
+#endif // BUFFERED_SINK_H
@@ -0,0 +1,114 @@
+// checksum.cpp
+#include "checksum.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+const size_t FILE_BUFFER_SIZE = 1 << 20;
+
+uint64_t rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t mixLane(uint64_t lane, uint64_t input) {
+    return rotl(lane + input * PRIME2, 31) * PRIME1;
+}
+
+uint64_t mergeLane(uint64_t hash, uint64_t lane) {
+    return (hash ^ mixLane(0, lane)) * PRIME1 + PRIME4;
+}
+
+// Inputs are read in native byte order, like every other file the merger keeps for itself
+uint64_t read64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+void StreamChecksum::update(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    total_ += size;
+    if (tailSize_ > 0) {
+        size_t fill = std::min(size, STRIPE - tailSize_);
+        std::memcpy(tail_ + tailSize_, bytes, fill);
+        tailSize_ += fill;
+        bytes += fill;
+        size -= fill;
+        if (tailSize_ < STRIPE) return;
+        addStripes(tail_, 1);
+        tailSize_ = 0;
+    }
+    addStripes(bytes, size / STRIPE);
+    tailSize_ = size % STRIPE;
+    std::memcpy(tail_, bytes + size - tailSize_, tailSize_);
+}
+
+void StreamChecksum::addStripes(const unsigned char* data, size_t stripes) {
+    uint64_t lanes[4] = {lanes_[0], lanes_[1], lanes_[2], lanes_[3]};
+    for (size_t i = 0; i < stripes; ++i, data += STRIPE) {
+        lanes[0] = mixLane(lanes[0], read64(data));
+        lanes[1] = mixLane(lanes[1], read64(data + 8));
+        lanes[2] = mixLane(lanes[2], read64(data + 16));
+        lanes[3] = mixLane(lanes[3], read64(data + 24));
+    }
+    std::memcpy(lanes_, lanes, sizeof(lanes));
+}
+
+uint64_t StreamChecksum::value() const {
+    uint64_t hash;
+    if (total_ >= STRIPE) {
+        hash = rotl(lanes_[0], 1) + rotl(lanes_[1], 7) + rotl(lanes_[2], 12) + rotl(lanes_[3], 18);
+        for (uint64_t lane : lanes_) hash = mergeLane(hash, lane);
+    }
+    else {
+        hash = PRIME5;
+    }
+    hash += total_;
+
+    const unsigned char* p = tail_;
+    size_t left = tailSize_;
+    for (; left >= 8; p += 8, left -= 8) hash = rotl(hash ^ mixLane(0, read64(p)), 27) * PRIME1 + PRIME4;
+    if (left >= 4) {
+        hash = rotl(hash ^ (static_cast<uint64_t>(read32(p)) * PRIME1), 23) * PRIME2 + PRIME3;
+        p += 4;
+        left -= 4;
+    }
+    for (; left > 0; ++p, --left) hash = rotl(hash ^ (*p * PRIME5), 11) * PRIME1;
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+bool fileChecksum(const std::string& path, uint64_t& size, uint64_t& checksum) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<char> buffer(FILE_BUFFER_SIZE);
+    StreamChecksum sum;
+    size_t bytes;
+    while ((bytes = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) sum.update(buffer.data(), bytes);
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    size = sum.size();
+    checksum = sum.value();
+    return ok;
+}
@@ -0,0 +1,33 @@
+// checksum.h
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Incremental XXH64 (seed 0) of a byte stream fed in pieces of any size. Fast enough to run on
+// the writer thread of every temp run, where it costs a fraction of the write itself.
+class StreamChecksum {
+public:
+    void update(const void* data, size_t size);
+
+    // Checksum of everything fed so far
+    uint64_t value() const;
+    uint64_t size() const { return total_; }
+
+private:
+    static const size_t STRIPE = 32;
+
+    uint64_t lanes_[4] = {0x60EA27EEADC0B5D6ull, 0xC2B2AE3D27D4EB4Full, 0, 0x61C8864E7A143579ull};
+    unsigned char tail_[STRIPE]; // Bytes of a partial stripe
+    size_t tailSize_ = 0;
+    uint64_t total_ = 0;
+
+    void addStripes(const unsigned char* data, size_t stripes);
+};
+
+// Checksum and size of the contents of 'path'; false if it cannot be read
+bool fileChecksum(const std::string& path, uint64_t& size, uint64_t& checksum);
+
+#endif // CHECKSUM_H
@@ -0,0 +1,64 @@
+// column_batch.cpp
+#include "column_batch.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+void ColumnBatch::clear() {
+    timestamps.clear();
+    symbols.clear();
+    prices.clear();
+    sizes.clear();
+    exchanges.clear();
+    types.clear();
+}
+
+void ColumnBatch::reserve(size_t rows) {
+    timestamps.reserve(rows);
+    symbols.reserve(rows);
+    prices.reserve(rows);
+    sizes.reserve(rows);
+    exchanges.reserve(rows);
+    types.reserve(rows);
+}
+
+void ColumnBatch::push(const MarketRecord& record) {
+    timestamps.push_back(record.timestamp);
+    symbols.push_back(record.symbolId);
+    prices.push_back(record.price);
+    sizes.push_back(record.size);
+    exchanges.push_back(record.exchange);
+    types.push_back(record.type);
+}
+
+void ColumnBatch::append(const ColumnBatch& other, size_t row) {
+    timestamps.push_back(other.timestamps[row]);
+    symbols.push_back(other.symbols[row]);
+    prices.push_back(other.prices[row]);
+    sizes.push_back(other.sizes[row]);
+    exchanges.push_back(other.exchanges[row]);
+    types.push_back(other.types[row]);
+}
+
+MarketRecord ColumnBatch::record(size_t row) const {
+    MarketRecord record;
+    record.timestamp = timestamps[row];
+    record.symbolId = symbols[row];
+    record.price = prices[row];
+    record.size = sizes[row];
+    record.exchange = exchanges[row];
+    record.type = types[row];
+    return record;
+}
+
+size_t ColumnBatch::cacheRows() {
+    long l2Bytes = 256 * 1024; // Typical per-core L2 where the size cannot be queried
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long reported = ::sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (reported > 0) l2Bytes = reported;
+#endif
+    const size_t rowBytes = sizeof(int64_t) * 2 + sizeof(uint32_t) * 4;
+    return std::max<size_t>(static_cast<size_t>(l2Bytes) / 2 / rowBytes, 1024);
+}
@@ -0,0 +1,33 @@
+// column_batch.h
+#ifndef COLUMN_BATCH_H
+#define COLUMN_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "market_record.h"
+
+// Struct-of-arrays block of parsed records: one contiguous array per field, so a pass over one
+// field (timestamps for the merge, prices for analytics) touches only that field's memory
+struct ColumnBatch {
+    std::vector<int64_t> timestamps; // Nanoseconds since the Unix epoch
+    std::vector<uint32_t> symbols;   // SymbolTable ids
+    std::vector<int64_t> prices;     // Fixed point, see PRICE_SCALE
+    std::vector<uint32_t> sizes;
+    std::vector<uint32_t> exchanges; // FieldDictionary ids
+    std::vector<uint32_t> types;     // FieldDictionary ids
+
+    size_t size() const { return timestamps.size(); }
+    bool empty() const { return timestamps.empty(); }
+    void clear();
+    void reserve(size_t rows);
+
+    void push(const MarketRecord& record);
+    void append(const ColumnBatch& other, size_t row); // Copies row 'row' of 'other'
+    MarketRecord record(size_t row) const;
+
+    // Rows per batch so that the columns of one batch fill about half of the L2 cache
+    static size_t cacheRows();
+};
+
+#endif // COLUMN_BATCH_H
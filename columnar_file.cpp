@@ -0,0 +1,396 @@
+// columnar_file.cpp
+#include "columnar_file.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char MAGIC[8] = {'M', 'D', 'M', 'C', 'O', 'L', '0', '1'};
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putFixed(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) out += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+void putString(std::string& out, const std::string& text) {
+    putVarint(out, text.size());
+    out += text;
+}
+
+// Bounds-checked cursor over encoded bytes; any overrun clears ok()
+class ByteCursor {
+public:
+    ByteCursor(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+
+    bool ok() const { return ok_; }
+    bool atEnd() const { return p_ == end_; }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p_ == end_) break;
+            uint8_t byte = *p_++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    uint64_t fixed(size_t bytes) {
+        if (static_cast<size_t>(end_ - p_) < bytes) {
+            ok_ = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(*p_++) << (8 * i);
+        return value;
+    }
+
+    std::string string() {
+        uint64_t size = varint();
+        if (!ok_ || static_cast<uint64_t>(end_ - p_) < size) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string text(reinterpret_cast<const char*>(p_), static_cast<size_t>(size));
+        p_ += size;
+        return text;
+    }
+
+    const uint8_t* take(size_t size) {
+        if (static_cast<size_t>(end_ - p_) < size) {
+            ok_ = false;
+            return nullptr;
+        }
+        const uint8_t* data = p_;
+        p_ += size;
+        return data;
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    bool ok_ = true;
+};
+
+bool seekTo(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+uint64_t fileSize(std::FILE* file) {
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0) return 0;
+    return static_cast<uint64_t>(_ftelli64(file));
+#else
+    if (fseeko(file, 0, SEEK_END) != 0) return 0;
+    return static_cast<uint64_t>(ftello(file));
+#endif
+}
+
+template <typename T>
+void encodePlain(const std::vector<T>& values, std::string& out) {
+    for (T value : values) putVarint(out, value);
+}
+
+void encodeDeltas(const std::vector<int64_t>& values, std::string& out) {
+    int64_t previous = 0;
+    for (int64_t value : values) {
+        putVarint(out, zigzag(static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(previous))));
+        previous = value;
+    }
+}
+
+template <typename T>
+bool decodePlain(ByteCursor& in, size_t rows, std::vector<T>& values) {
+    values.resize(rows);
+    for (size_t i = 0; i < rows; ++i) values[i] = static_cast<T>(in.varint());
+    return in.ok() && in.atEnd();
+}
+
+bool decodeDeltas(ByteCursor& in, size_t rows, std::vector<int64_t>& values) {
+    values.resize(rows);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        previous += static_cast<uint64_t>(unzigzag(in.varint()));
+        values[i] = static_cast<int64_t>(previous);
+    }
+    return in.ok() && in.atEnd();
+}
+
+} // namespace
+
+bool ColumnCsvWriter::open(const std::string& path, size_t bufferSize) {
+    if (!out_.open(path, bufferSize)) return false;
+    out_.write("Symbol,Timestamp,Price,Size,Exchange,Type\n"); // Write header
+    return true;
+}
+
+void ColumnCsvWriter::write(const ColumnBatch& batch) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+        line_.clear();
+        line_ += symbols_.name(batch.symbols[i]);
+        line_ += ',';
+        formatTimestamp(batch.timestamps[i], line_);
+        line_ += ',';
+        formatPrice(batch.prices[i], line_);
+        line_ += ',';
+        line_ += std::to_string(batch.sizes[i]);
+        line_ += ',';
+        line_ += exchanges_.name(batch.exchanges[i]);
+        line_ += ',';
+        line_ += types_.name(batch.types[i]);
+        line_ += '\n';
+        out_.write(line_);
+    }
+}
+
+bool ColumnarWriter::open(const std::string& path, size_t bufferSize) {
+    if (!out_.open(path, bufferSize)) return false;
+    out_.write(MAGIC, sizeof(MAGIC));
+    offset_ = sizeof(MAGIC);
+    pending_.clear();
+    pending_.reserve(chunkRows_);
+    chunks_.clear();
+    return true;
+}
+
+void ColumnarWriter::write(const ColumnBatch& batch) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+        pending_.append(batch, i);
+        if (pending_.size() == chunkRows_) writeChunk();
+    }
+}
+
+void ColumnarWriter::writeChunk() {
+    if (pending_.empty()) return;
+    for (auto& column : encoded_) column.clear();
+    encodeDeltas(pending_.timestamps, encoded_[0]);
+    encodePlain(pending_.symbols, encoded_[1]);
+    encodeDeltas(pending_.prices, encoded_[2]);
+    encodePlain(pending_.sizes, encoded_[3]);
+    encodePlain(pending_.exchanges, encoded_[4]);
+    encodePlain(pending_.types, encoded_[5]);
+
+    ColumnarChunkInfo info;
+    info.offset = offset_;
+    info.rows = static_cast<uint32_t>(pending_.size());
+    auto range = std::minmax_element(pending_.timestamps.begin(), pending_.timestamps.end());
+    info.minTimestamp = *range.first;
+    info.maxTimestamp = *range.second;
+    info.symbolBitmap.assign((symbols_.size() + 7) / 8, 0);
+    for (uint32_t id : pending_.symbols) info.symbolBitmap[id / 8] |= static_cast<uint8_t>(1 << (id % 8));
+    for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+        info.columnBytes[c] = static_cast<uint32_t>(encoded_[c].size());
+        out_.write(encoded_[c]);
+        offset_ += encoded_[c].size();
+    }
+    chunks_.push_back(std::move(info));
+    pending_.clear();
+}
+
+bool ColumnarWriter::close() {
+    writeChunk();
+    std::string footer;
+    putVarint(footer, symbols_.size());
+    for (size_t i = 0; i < symbols_.size(); ++i) putString(footer, symbols_.name(static_cast<uint32_t>(i)));
+    for (const FieldDictionary* dictionary : {&exchanges_, &types_}) {
+        putVarint(footer, dictionary->size());
+        for (size_t i = 0; i < dictionary->size(); ++i) putString(footer, dictionary->name(static_cast<uint32_t>(i)));
+    }
+    putVarint(footer, chunks_.size());
+    for (const ColumnarChunkInfo& chunk : chunks_) {
+        putFixed(footer, chunk.offset, 8);
+        putFixed(footer, chunk.rows, 4);
+        putFixed(footer, static_cast<uint64_t>(chunk.minTimestamp), 8);
+        putFixed(footer, static_cast<uint64_t>(chunk.maxTimestamp), 8);
+        for (uint32_t bytes : chunk.columnBytes) putFixed(footer, bytes, 4);
+        footer.append(reinterpret_cast<const char*>(chunk.symbolBitmap.data()), chunk.symbolBitmap.size());
+    }
+    putFixed(footer, footer.size(), 8);
+    footer.append(MAGIC, sizeof(MAGIC));
+    out_.write(footer);
+    return out_.close();
+}
+
+ColumnarReader::~ColumnarReader() {
+    close();
+}
+
+void ColumnarReader::close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    chunks_.clear();
+}
+
+bool ColumnarReader::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_) return false;
+
+    // Leading magic, then the trailer: footer size and magic again
+    uint64_t size = fileSize(file_);
+    char head[sizeof(MAGIC)];
+    uint8_t trailer[16];
+    if (size < sizeof(MAGIC) + sizeof(trailer) || !seekTo(file_, 0) ||
+        std::fread(head, 1, sizeof(head), file_) != sizeof(head) || std::memcmp(head, MAGIC, sizeof(MAGIC)) != 0 ||
+        !seekTo(file_, size - sizeof(trailer)) ||
+        std::fread(trailer, 1, sizeof(trailer), file_) != sizeof(trailer) ||
+        std::memcmp(trailer + 8, MAGIC, sizeof(MAGIC)) != 0) {
+        close();
+        return false;
+    }
+    uint64_t footerSize = ByteCursor(trailer, 8).fixed(8);
+    if (footerSize > size - sizeof(MAGIC) - sizeof(trailer)) {
+        close();
+        return false;
+    }
+    std::vector<uint8_t> footer(static_cast<size_t>(footerSize));
+    if (!seekTo(file_, size - sizeof(trailer) - footerSize) ||
+        std::fread(footer.data(), 1, footer.size(), file_) != footer.size()) {
+        close();
+        return false;
+    }
+
+    ByteCursor in(footer.data(), footer.size());
+    std::vector<std::string> names(static_cast<size_t>(std::min<uint64_t>(in.varint(), footer.size())));
+    for (auto& name : names) name = in.string();
+    symbols_ = SymbolTable(names);
+    exchanges_ = FieldDictionary();
+    types_ = FieldDictionary();
+    for (FieldDictionary* dictionary : {&exchanges_, &types_}) {
+        uint64_t count = in.varint();
+        for (uint64_t i = 0; i < count && in.ok(); ++i) dictionary->id(in.string());
+    }
+    uint64_t chunkCount = in.varint();
+    const uint64_t dataEnd = size - sizeof(trailer) - footerSize;
+    size_t bitmapBytes = (names.size() + 7) / 8;
+    for (uint64_t i = 0; i < chunkCount && in.ok(); ++i) {
+        ColumnarChunkInfo chunk;
+        chunk.offset = in.fixed(8);
+        chunk.rows = static_cast<uint32_t>(in.fixed(4));
+        chunk.minTimestamp = static_cast<int64_t>(in.fixed(8));
+        chunk.maxTimestamp = static_cast<int64_t>(in.fixed(8));
+        for (uint32_t& bytes : chunk.columnBytes) bytes = static_cast<uint32_t>(in.fixed(4));
+        const uint8_t* bitmap = in.take(bitmapBytes);
+        if (bitmap) chunk.symbolBitmap.assign(bitmap, bitmap + bitmapBytes);
+        uint64_t chunkBytes = 0;
+        for (uint32_t bytes : chunk.columnBytes) chunkBytes += bytes;
+        if (chunk.offset > dataEnd || chunkBytes > dataEnd - chunk.offset) break; // Points past the chunk data
+        chunks_.push_back(std::move(chunk));
+    }
+    if (!in.ok() || !in.atEnd() || chunks_.size() != chunkCount || symbols_.size() != names.size()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+uint64_t ColumnarReader::rows() const {
+    uint64_t total = 0;
+    for (const ColumnarChunkInfo& chunk : chunks_) total += chunk.rows;
+    return total;
+}
+
+std::vector<size_t> ColumnarReader::chunksFor(int64_t from, int64_t to, const std::vector<uint32_t>& symbolIds) const {
+    // The file is in timestamp order, so maxTimestamp grows monotonically across chunks
+    auto first = std::lower_bound(chunks_.begin(), chunks_.end(), from,
+                                  [](const ColumnarChunkInfo& chunk, int64_t t) { return chunk.maxTimestamp < t; });
+    std::vector<size_t> result;
+    for (auto it = first; it != chunks_.end() && it->minTimestamp < to; ++it) {
+        bool wanted = symbolIds.empty();
+        for (size_t i = 0; i < symbolIds.size() && !wanted; ++i) wanted = it->hasSymbol(symbolIds[i]);
+        if (wanted) result.push_back(static_cast<size_t>(it - chunks_.begin()));
+    }
+    return result;
+}
+
+bool ColumnarReader::readChunk(size_t index, ColumnBatch& batch) {
+    batch.clear();
+    if (!file_ || index >= chunks_.size()) return false;
+    const ColumnarChunkInfo& chunk = chunks_[index];
+    size_t total = 0;
+    for (uint32_t bytes : chunk.columnBytes) total += bytes;
+    buffer_.resize(total);
+    if (!seekTo(file_, chunk.offset) || std::fread(buffer_.data(), 1, total, file_) != total) return false;
+
+    // Columns follow each other in the order they were encoded
+    const uint8_t* column = buffer_.data();
+    size_t c = 0;
+    auto cursor = [&]() {
+        ByteCursor in(column, chunk.columnBytes[c]);
+        column += chunk.columnBytes[c++];
+        return in;
+    };
+    ByteCursor timestamps = cursor();
+    ByteCursor symbols = cursor();
+    ByteCursor prices = cursor();
+    ByteCursor sizes = cursor();
+    ByteCursor exchanges = cursor();
+    ByteCursor types = cursor();
+    bool ok = decodeDeltas(timestamps, chunk.rows, batch.timestamps) &&
+              decodePlain(symbols, chunk.rows, batch.symbols) && decodeDeltas(prices, chunk.rows, batch.prices) &&
+              decodePlain(sizes, chunk.rows, batch.sizes) && decodePlain(exchanges, chunk.rows, batch.exchanges) &&
+              decodePlain(types, chunk.rows, batch.types);
+    if (!ok) {
+        batch.clear();
+        return false;
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (batch.symbols[i] >= symbols_.size() || batch.exchanges[i] >= exchanges_.size() ||
+            batch.types[i] >= types_.size()) {
+            batch.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool convertColumnarToCsv(const std::string& inputFile, const std::string& outputFile) {
+    ColumnarReader reader;
+    if (!reader.open(inputFile)) {
+        std::cerr << "Failed to read columnar file " << inputFile << std::endl;
+        return false;
+    }
+    ColumnCsvWriter out(reader.symbols(), reader.exchanges(), reader.types());
+    if (!out.open(outputFile)) {
+        std::cerr << "Failed to open " << outputFile << std::endl;
+        return false;
+    }
+    ColumnBatch batch;
+    for (size_t i = 0; i < reader.chunks().size(); ++i) {
+        if (!reader.readChunk(i, batch)) {
+            std::cerr << "Damaged chunk " << i << " in " << inputFile << std::endl;
+            out.close();
+            return false;
+        }
+        out.write(batch);
+    }
+    if (!out.close()) {
+        std::cerr << "Failed to write " << outputFile << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,125 @@
+// columnar_file.h
+#ifndef COLUMNAR_FILE_H
+#define COLUMNAR_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "buffered_sink.h"
+#include "column_batch.h"
+#include "market_record.h"
+#include "merge_key.h"
+
+// Writes merged column batches in the usual CSV layout, normalized by formatting from the parsed
+// values: no blanks around fields, shortest price, 3, 6 or 9 fractional timestamp digits
+class ColumnCsvWriter {
+public:
+    ColumnCsvWriter(const SymbolTable& symbols, const FieldDictionary& exchanges, const FieldDictionary& types)
+        : symbols_(symbols), exchanges_(exchanges), types_(types) {}
+
+    bool open(const std::string& path, size_t bufferSize = BufferedSink::DEFAULT_BUFFER_SIZE);
+    void write(const ColumnBatch& batch);
+    bool close() { return out_.close(); }
+    const BufferedSink& sink() const { return out_; }
+
+private:
+    const SymbolTable& symbols_;
+    const FieldDictionary& exchanges_;
+    const FieldDictionary& types_;
+    BufferedSink out_;
+    std::string line_; // Scratch for one formatted row
+};
+
+// Columnar file layout (all integers little-endian):
+//   "MDMCOL01"
+//   chunk*     - one per chunkRows records; each column encoded on its own as LEB128 varints:
+//                timestamps and prices as zigzag deltas, the other columns as plain values
+//   footer     - symbol, exchange and type names, then per chunk its offset, row count,
+//                min/max timestamp, encoded column sizes and a bitmap of the symbols it holds
+//   uint64 footer size, "MDMCOL01"
+// The footer lets a reader pick the chunks overlapping a time range or a set of symbols
+// without touching the rest of the file.
+const size_t COLUMN_COUNT = 6;
+
+struct ColumnarChunkInfo {
+    uint64_t offset = 0;
+    uint32_t rows = 0;
+    int64_t minTimestamp = 0;
+    int64_t maxTimestamp = 0;
+    uint32_t columnBytes[COLUMN_COUNT] = {};
+    std::vector<uint8_t> symbolBitmap; // Bit i set if symbol id i occurs in the chunk
+
+    bool hasSymbol(uint32_t id) const {
+        return id / 8 < symbolBitmap.size() && (symbolBitmap[id / 8] >> (id % 8) & 1);
+    }
+};
+
+// Writes merged column batches as a columnar file. The dictionaries are read when the file is
+// closed, so they may keep growing while batches are written.
+class ColumnarWriter {
+public:
+    static const size_t DEFAULT_CHUNK_ROWS = 65536;
+
+    ColumnarWriter(const SymbolTable& symbols, const FieldDictionary& exchanges, const FieldDictionary& types,
+                   size_t chunkRows = DEFAULT_CHUNK_ROWS)
+        : symbols_(symbols), exchanges_(exchanges), types_(types), chunkRows_(chunkRows > 0 ? chunkRows : 1) {}
+
+    bool open(const std::string& path, size_t bufferSize = BufferedSink::DEFAULT_BUFFER_SIZE);
+    void write(const ColumnBatch& batch);
+    bool close(); // Writes the last chunk and the footer
+    const BufferedSink& sink() const { return out_; }
+
+private:
+    const SymbolTable& symbols_;
+    const FieldDictionary& exchanges_;
+    const FieldDictionary& types_;
+    size_t chunkRows_;
+    BufferedSink out_;
+    uint64_t offset_ = 0; // Bytes written so far
+    ColumnBatch pending_; // Rows of the chunk being filled
+    std::vector<ColumnarChunkInfo> chunks_;
+    std::string encoded_[COLUMN_COUNT]; // Scratch for the columns of one chunk
+
+    void writeChunk();
+};
+
+// Reads a columnar file: the footer on open(), chunks on demand
+class ColumnarReader {
+public:
+    ColumnarReader() = default;
+    ~ColumnarReader();
+
+    ColumnarReader(const ColumnarReader&) = delete;
+    ColumnarReader& operator=(const ColumnarReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const SymbolTable& symbols() const { return symbols_; }
+    const FieldDictionary& exchanges() const { return exchanges_; }
+    const FieldDictionary& types() const { return types_; }
+    const std::vector<ColumnarChunkInfo>& chunks() const { return chunks_; }
+    uint64_t rows() const;
+
+    // Chunks that may hold records with timestamps in [from, to) and, unless 'symbolIds' is
+    // empty, one of those symbols. Chunks are in time order, so the range is found by binary search.
+    std::vector<size_t> chunksFor(int64_t from, int64_t to, const std::vector<uint32_t>& symbolIds = {}) const;
+
+    // Decodes chunk 'index' into 'batch' (replacing its contents); false if the file is damaged
+    bool readChunk(size_t index, ColumnBatch& batch);
+
+private:
+    std::FILE* file_ = nullptr;
+    SymbolTable symbols_;
+    FieldDictionary exchanges_;
+    FieldDictionary types_;
+    std::vector<ColumnarChunkInfo> chunks_;
+    std::vector<uint8_t> buffer_; // Encoded columns of the chunk being read
+};
+
+// --convert-to-csv: writes the records of a columnar file as CSV; false (with a message on
+// std::cerr) on failure
+bool convertColumnarToCsv(const std::string& inputFile, const std::string& outputFile);
+
+#endif // COLUMNAR_FILE_H
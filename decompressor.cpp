@@ -0,0 +1,314 @@
+// decompressor.cpp
+#include "decompressor.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#ifdef MDM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MDM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const size_t INPUT_BUFFER_SIZE = 1 << 16;
+
+bool endsWith(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+#if defined(MDM_HAVE_ZLIB) || defined(MDM_HAVE_ZSTD)
+bool seekFile(std::FILE* file, int64_t offset, int whence = SEEK_SET) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), whence) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), whence) == 0;
+#endif
+}
+#endif
+
+#ifdef MDM_HAVE_ZLIB
+// Concatenated gzip members (what "cat a.gz b.gz" or bgzip produce) decode as one stream
+class GzipDecompressor : public Decompressor {
+public:
+    ~GzipDecompressor() override {
+        if (initialized_) inflateEnd(&stream_);
+    }
+
+protected:
+    bool init() override {
+        stream_ = z_stream();
+        initialized_ = inflateInit2(&stream_, 15 + 32) == Z_OK; // 32: expect a gzip (or zlib) header
+        return initialized_;
+    }
+
+    size_t decode(char* dest, size_t capacity) override {
+        stream_.next_out = reinterpret_cast<Bytef*>(dest);
+        stream_.avail_out = static_cast<uInt>(capacity);
+        while (stream_.avail_out == capacity && !corrupt_) {
+            if (stream_.avail_in == 0) {
+                size_t bytes = std::fread(input_.data(), 1, input_.size(), file_);
+                if (bytes == 0) {
+                    if (inMember_) reportCorrupt(); // Truncated
+                    break;
+                }
+                stream_.next_in = reinterpret_cast<Bytef*>(input_.data());
+                stream_.avail_in = static_cast<uInt>(bytes);
+            }
+            inMember_ = true;
+            int status = inflate(&stream_, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                inflateReset(&stream_); // A further member may follow
+                inMember_ = false;
+            }
+            else if (status != Z_OK && !(status == Z_BUF_ERROR && stream_.avail_in == 0)) {
+                reportCorrupt();
+            }
+        }
+        return capacity - stream_.avail_out;
+    }
+
+    bool restartAt(uint64_t) override {
+        if (!seekFile(file_, 0) || inflateReset(&stream_) != Z_OK) return false;
+        stream_.avail_in = 0;
+        inMember_ = false;
+        return true;
+    }
+
+private:
+    z_stream stream_;
+    bool initialized_ = false;
+    bool inMember_ = false;
+};
+#endif
+
+#ifdef MDM_HAVE_ZSTD
+// Reads the seek table of the zstd seekable format: a skippable frame at the end of the file
+// holding the compressed and decompressed size of each frame, so any frame can be decoded alone
+class ZstdDecompressor : public Decompressor {
+public:
+    static const uint32_t SEEKABLE_MAGIC = 0x8F92EAB1;
+
+    ~ZstdDecompressor() override { ZSTD_freeDCtx(context_); }
+
+    bool seekable() const { return !frames_.empty(); }
+    uint64_t totalSize() const { return totalSize_; }
+
+protected:
+    bool init() override {
+        context_ = ZSTD_createDCtx();
+        if (!context_) return false;
+        readSeekTable();
+        return seekFile(file_, 0);
+    }
+
+    size_t decode(char* dest, size_t capacity) override {
+        ZSTD_outBuffer out{dest, capacity, 0};
+        while (out.pos == 0 && !corrupt_) {
+            if (in_.pos == in_.size) {
+                size_t bytes = std::fread(input_.data(), 1, input_.size(), file_);
+                if (bytes == 0) {
+                    if (inFrame_) reportCorrupt(); // Truncated
+                    break;
+                }
+                in_ = ZSTD_inBuffer{input_.data(), bytes, 0};
+            }
+            size_t status = ZSTD_decompressStream(context_, &out, &in_);
+            if (ZSTD_isError(status)) reportCorrupt();
+            else inFrame_ = status != 0; // 0: a frame just ended
+        }
+        return out.pos;
+    }
+
+    uint64_t restartPoint(uint64_t offset) const override {
+        auto it = std::upper_bound(frames_.begin(), frames_.end(), offset,
+                                   [](uint64_t value, const Frame& frame) { return value < frame.decompressedStart; });
+        return it == frames_.begin() ? 0 : (it - 1)->decompressedStart;
+    }
+
+    bool restartAt(uint64_t offset) override {
+        uint64_t compressedStart = 0;
+        for (const Frame& frame : frames_) {
+            if (frame.decompressedStart == offset) {
+                compressedStart = frame.compressedStart;
+                break;
+            }
+        }
+        if (!seekFile(file_, static_cast<int64_t>(compressedStart))) return false;
+        ZSTD_DCtx_reset(context_, ZSTD_reset_session_only);
+        in_ = ZSTD_inBuffer{input_.data(), 0, 0};
+        inFrame_ = false;
+        return true;
+    }
+
+private:
+    struct Frame {
+        uint64_t compressedStart;
+        uint64_t decompressedStart;
+    };
+    ZSTD_DCtx* context_ = nullptr;
+    ZSTD_inBuffer in_{nullptr, 0, 0};
+    bool inFrame_ = false;
+    std::vector<Frame> frames_; // Empty without a valid seek table
+    uint64_t totalSize_ = 0;
+
+    static uint32_t readU32(const unsigned char* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    void readSeekTable() {
+        // Footer: u32 frame count, descriptor byte (bit 7: entries carry a checksum), u32 magic
+        unsigned char footer[9];
+        if (!seekFile(file_, 0, SEEK_END)) return;
+        long fileSize = std::ftell(file_);
+        if (!seekFile(file_, -static_cast<int64_t>(sizeof(footer)), SEEK_END) || std::fread(footer, 1, sizeof(footer), file_) != sizeof(footer) ||
+            readU32(footer + 5) != SEEKABLE_MAGIC) {
+            return;
+        }
+        uint64_t count = readU32(footer);
+        size_t entrySize = (footer[4] & 0x80) ? 12 : 8;
+        if (fileSize < 0 || count * entrySize + sizeof(footer) > static_cast<uint64_t>(fileSize)) return;
+        std::vector<unsigned char> entries(static_cast<size_t>(count) * entrySize);
+        if (!seekFile(file_, -static_cast<int64_t>(entries.size() + sizeof(footer)), SEEK_END) ||
+            std::fread(entries.data(), 1, entries.size(), file_) != entries.size()) {
+            return;
+        }
+        uint64_t compressed = 0;
+        uint64_t decompressed = 0;
+        std::vector<Frame> frames;
+        frames.reserve(static_cast<size_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            frames.push_back({compressed, decompressed});
+            compressed += readU32(&entries[i * entrySize]);
+            decompressed += readU32(&entries[i * entrySize + 4]);
+        }
+        frames_ = std::move(frames);
+        totalSize_ = decompressed;
+    }
+};
+#endif
+
+} // namespace
+
+Compression compressionOf(std::string_view path) {
+    if (endsWith(path, ".gz")) return Compression::Gzip;
+    if (endsWith(path, ".zst")) return Compression::Zstd;
+    return Compression::None;
+}
+
+bool compressionSupported(Compression compression) {
+    switch (compression) {
+    case Compression::None:
+        return true;
+    case Compression::Gzip:
+#ifdef MDM_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Compression::Zstd:
+#ifdef MDM_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+std::string_view withoutCompressionExtension(std::string_view path) {
+    switch (compressionOf(path)) {
+    case Compression::Gzip:
+        return path.substr(0, path.size() - 3);
+    case Compression::Zstd:
+        return path.substr(0, path.size() - 4);
+    default:
+        return path;
+    }
+}
+
+std::unique_ptr<Decompressor> Decompressor::open(const std::string& path) {
+    Compression compression = compressionOf(path);
+    if (!compressionSupported(compression)) {
+        std::cerr << path << ": built without " << (compression == Compression::Gzip ? "zlib" : "zstd") << " support"
+                  << std::endl;
+        return nullptr;
+    }
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return nullptr;
+
+    std::unique_ptr<Decompressor> decoder;
+#ifdef MDM_HAVE_ZLIB
+    if (compression == Compression::Gzip) decoder = std::make_unique<GzipDecompressor>();
+#endif
+#ifdef MDM_HAVE_ZSTD
+    if (compression == Compression::Zstd) decoder = std::make_unique<ZstdDecompressor>();
+#endif
+    if (!decoder) {
+        std::fclose(file);
+        return nullptr;
+    }
+    decoder->path_ = path;
+    decoder->file_ = file;
+    decoder->input_.resize(INPUT_BUFFER_SIZE);
+    if (!decoder->init()) return nullptr;
+    return decoder;
+}
+
+bool Decompressor::contentSize(const std::string& path, uint64_t& size) {
+    Compression compression = compressionOf(path);
+    if (compression == Compression::None) {
+        std::error_code error;
+        size = fs::file_size(path, error);
+        return !error;
+    }
+#ifdef MDM_HAVE_ZSTD
+    if (compression == Compression::Zstd) {
+        std::unique_ptr<Decompressor> decoder = open(path);
+        auto* zstd = static_cast<ZstdDecompressor*>(decoder.get());
+        if (!zstd || !zstd->seekable()) return false;
+        size = zstd->totalSize();
+        return true;
+    }
+#endif
+    return false;
+}
+
+Decompressor::~Decompressor() {
+    if (file_) std::fclose(file_);
+}
+
+size_t Decompressor::read(char* dest, size_t capacity) {
+    size_t bytes = decode(dest, capacity);
+    position_ += bytes;
+    return bytes;
+}
+
+bool Decompressor::seek(uint64_t offset) {
+    uint64_t point = restartPoint(offset);
+    if (offset < position_ || point > position_) {
+        if (!restartAt(point)) return false;
+        position_ = point;
+        corrupt_ = false;
+    }
+    std::vector<char> skipped(std::min<uint64_t>(offset - position_, INPUT_BUFFER_SIZE));
+    while (position_ < offset) {
+        if (read(skipped.data(), static_cast<size_t>(std::min<uint64_t>(offset - position_, skipped.size()))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t Decompressor::restartPoint(uint64_t) const {
+    return 0;
+}
+
+void Decompressor::reportCorrupt() {
+    if (!corrupt_) std::cerr << "Corrupt or truncated compressed data in " << path_ << std::endl;
+    corrupt_ = true;
+}
@@ -0,0 +1,73 @@
+// decompressor.h
+#ifndef DECOMPRESSOR_H
+#define DECOMPRESSOR_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compression of an input file, named by its extension
+enum class Compression {
+    None,
+    Gzip, // ".gz": one or more gzip members (needs MDM_HAVE_ZLIB)
+    Zstd  // ".zst": one or more zstd frames, optionally with a seekable-format seek table (needs MDM_HAVE_ZSTD)
+};
+
+Compression compressionOf(std::string_view path);
+
+// Whether this build can decode 'compression'
+bool compressionSupported(Compression compression);
+
+// 'path' without a trailing ".gz" or ".zst"
+std::string_view withoutCompressionExtension(std::string_view path);
+
+// Decodes a compressed file sequentially. Offsets are positions in the uncompressed data, so
+// FileReader::tell(), sidecar indexes and append offsets mean the same for every input.
+class Decompressor {
+public:
+    // Opens 'path' for its compression; nullptr (having reported why) if it cannot be decoded
+    static std::unique_ptr<Decompressor> open(const std::string& path);
+
+    // Uncompressed size of any input: the file size for plain files, the seek table's total for
+    // seekable zstd; false if it is unknown without decoding the whole file
+    static bool contentSize(const std::string& path, uint64_t& size);
+
+    virtual ~Decompressor();
+
+    // Decodes up to 'capacity' bytes into 'dest'; 0 at the end of the data or on corrupt input
+    size_t read(char* dest, size_t capacity);
+
+    // True once corrupt or truncated data was met; read() then returns 0 as at the end
+    bool corrupt() const { return corrupt_; }
+
+    // Continues at uncompressed 'offset': from the nearest seek-table frame for seekable zstd,
+    // else by decoding forward (from the start when going back)
+    bool seek(uint64_t offset);
+
+protected:
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    std::vector<char> input_; // Compressed bytes read from file_
+    uint64_t position_ = 0;   // Uncompressed offset of the next byte read() returns
+    bool corrupt_ = false;
+
+    // Sets up decoding once path_, file_ and input_ are in place
+    virtual bool init() = 0;
+
+    // Decodes into 'dest'; 0 at the end
+    virtual size_t decode(char* dest, size_t capacity) = 0;
+
+    // Latest uncompressed offset at or before 'offset' where decoding can restart
+    virtual uint64_t restartPoint(uint64_t offset) const;
+
+    // Repositions the file and resets the decoder at restart point 'offset'
+    virtual bool restartAt(uint64_t offset) = 0;
+
+    // Reports corrupt or truncated data once
+    void reportCorrupt();
+};
+
+#endif // DECOMPRESSOR_H
@@ -0,0 +1,427 @@
+// file_reader.cpp
+#include "file_reader.h"
+#include "buffer_arena.h"
+#include "decompressor.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+// Blocks of a new reader's start that the kernel is asked to read ahead right away
+const size_t READAHEAD_BLOCKS = 4;
+
+bool seekFile(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+} // namespace
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Ring of blocks read ahead of the consumer. At most one I/O task per file is in flight; it fills
+// empty blocks in file order, so ordinary sequential fread() (or decode) calls suffice.
+struct FileReader::PrefetchRing {
+    std::FILE* file = nullptr;
+    std::unique_ptr<Decompressor> decoder; // In place of 'file' for compressed inputs
+    ThreadPool* pool = nullptr;
+    std::vector<std::vector<char>> blocks;
+    std::vector<size_t> sizes;
+    std::vector<char> ready;  // Block holds sizes[i] bytes not yet consumed
+    size_t fillIndex = 0;     // Next block the I/O task fills
+    size_t consumeIndex = 0;  // Next block the reader consumes
+    bool reading = false;     // An I/O task is in flight
+    bool eof = false;         // The I/O task reached end of file (or failed)
+    bool failed = false;      // It stopped on a read error or corrupt data
+    std::mutex mutex;
+    std::condition_variable filled;
+
+    ~PrefetchRing() {
+        if (file) std::fclose(file);
+    }
+
+    // Starts an I/O task if none is running and there is room; requires 'mutex' held
+    static void schedule(const std::shared_ptr<PrefetchRing>& ring) {
+        if (ring->reading || ring->eof || ring->ready[ring->fillIndex]) return;
+        ring->reading = true;
+        ring->pool->submit([ring] { ring->fill(); });
+    }
+
+    void fill() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!eof && !ready[fillIndex]) {
+            std::vector<char>& block = blocks[fillIndex];
+            lock.unlock();
+            size_t bytes = decoder ? decoder->read(block.data(), block.size()) : std::fread(block.data(), 1, block.size(), file);
+            lock.lock();
+            if (bytes == 0) {
+                eof = true;
+                failed = decoder ? decoder->corrupt() : std::ferror(file) != 0;
+            }
+            else {
+                sizes[fillIndex] = bytes;
+                ready[fillIndex] = 1;
+                fillIndex = (fillIndex + 1) % blocks.size();
+            }
+            filled.notify_all();
+        }
+        reading = false;
+    }
+};
+
+FileReader::~FileReader() {
+    close();
+}
+
+FileReader::FileReader(FileReader&& other) noexcept {
+    *this = std::move(other);
+}
+
+FileReader& FileReader::operator=(FileReader&& other) noexcept {
+    if (this != &other) {
+        close();
+        file_ = std::exchange(other.file_, nullptr);
+        decoder_ = std::move(other.decoder_);
+        ownBuffer_ = std::move(other.ownBuffer_);
+        buffer_ = std::exchange(other.buffer_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+        arena_ = std::exchange(other.arena_, nullptr);
+        data_ = std::exchange(other.data_, nullptr);
+        begin_ = other.begin_;
+        end_ = other.end_;
+        bufferOffset_ = other.bufferOffset_;
+        eof_ = other.eof_;
+        follow_ = other.follow_;
+        mapped_ = std::exchange(other.mapped_, false);
+        mapSize_ = other.mapSize_;
+        endOffset_ = other.endOffset_;
+        bytesRead_ = other.bytesRead_;
+        stallNanos_ = other.stallNanos_;
+        readCounter_ = other.readCounter_;
+        prefetch_ = std::move(other.prefetch_);
+        breaks_ = std::move(other.breaks_);
+        nextBreak_ = other.nextBreak_;
+        scanned_ = other.scanned_;
+        pendingComma_ = other.pendingComma_;
+        lineComma_ = other.lineComma_;
+    }
+    return *this;
+}
+
+bool FileReader::open(const std::string& path, const ReadOptions& options) {
+    close();
+    bytesRead_ = stallNanos_ = 0;
+    readCounter_ = options.readCounter;
+    resetScan();
+    bool compressed = compressionOf(path) != Compression::None;
+    follow_ = options.follow && !compressed; // Archives do not grow
+    endOffset_ = follow_ ? UINT64_MAX : options.endOffset;
+#ifndef _WIN32
+    if (options.mode == IoMode::Mmap && !follow_ && !compressed) {
+        return openMapped(path, options.startOffset, options.endOffset);
+    }
+#endif
+    // Stream mode (also the fallback where mmap is unavailable)
+    std::FILE* file = nullptr;
+    std::unique_ptr<Decompressor> decoder;
+    if (compressed) {
+        decoder = Decompressor::open(path);
+        if (!decoder || (options.startOffset > 0 && !decoder->seek(options.startOffset))) return false;
+    }
+    else {
+        file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+        std::setvbuf(file, nullptr, _IONBF, 0); // We buffer ourselves; avoid a second copy through stdio
+        if (options.startOffset > 0 && !seekFile(file, options.startOffset)) {
+            std::fclose(file);
+            return false;
+        }
+    }
+    size_t bufferSize = options.bufferSize > 0 ? options.bufferSize : ReadOptions::DEFAULT_BUFFER_SIZE;
+#if defined(POSIX_FADV_SEQUENTIAL)
+    if (file) {
+        // Widen the kernel's readahead, and start reading the first blocks now, so the first
+        // reads of the merge (which come one source at a time) find them in the page cache
+        int fd = fileno(file);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        ::posix_fadvise(fd, static_cast<off_t>(options.startOffset), static_cast<off_t>(bufferSize * READAHEAD_BLOCKS),
+                        POSIX_FADV_WILLNEED);
+    }
+#endif
+
+    if (options.prefetchPool && options.prefetchDepth > 0 && !follow_) {
+        prefetch_ = std::make_shared<PrefetchRing>();
+        prefetch_->file = file;
+        prefetch_->decoder = std::move(decoder);
+        prefetch_->pool = options.prefetchPool;
+        prefetch_->blocks.assign(options.prefetchDepth, std::vector<char>(bufferSize));
+        prefetch_->sizes.assign(options.prefetchDepth, 0);
+        prefetch_->ready.assign(options.prefetchDepth, 0);
+        std::lock_guard<std::mutex> lock(prefetch_->mutex);
+        PrefetchRing::schedule(prefetch_);
+    }
+    else {
+        file_ = file;
+        decoder_ = std::move(decoder);
+    }
+
+    allocateBuffer(bufferSize, options.arena);
+    data_ = buffer_;
+    begin_ = end_ = 0;
+    bufferOffset_ = options.startOffset;
+    eof_ = false;
+    return true;
+}
+
+bool FileReader::openMapped(const std::string& path, uint64_t startOffset, uint64_t endOffset) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = nullptr;
+    if (size > 0) {
+        mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        // Fault the start in ahead of the first scan, as the stream mode's readahead does
+        size_t pageStart = static_cast<size_t>(std::min<uint64_t>(startOffset, size)) & ~static_cast<size_t>(4095);
+        size_t willNeed = std::min(size - pageStart, ReadOptions::DEFAULT_BUFFER_SIZE * READAHEAD_BLOCKS);
+        ::madvise(static_cast<char*>(mapping) + pageStart, willNeed, MADV_WILLNEED);
+    }
+    ::close(fd); // The mapping keeps the file referenced
+
+    data_ = static_cast<const char*>(mapping);
+    mapSize_ = size;
+    end_ = static_cast<size_t>(std::min<uint64_t>(size, endOffset)); // Pages past the end are never touched
+    begin_ = static_cast<size_t>(std::min<uint64_t>(startOffset, end_));
+    bufferOffset_ = 0;
+    eof_ = true; // Everything is already "read"
+    mapped_ = true;
+    bytesRead_ = end_ - begin_; // Nor are those before the start
+    if (readCounter_) readCounter_->fetch_add(bytesRead_, std::memory_order_relaxed);
+    resetScan();
+    return true;
+#else
+    (void)path;
+    (void)startOffset;
+    (void)endOffset;
+    return false;
+#endif
+}
+
+void FileReader::close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+#ifndef _WIN32
+    if (mapped_ && data_) {
+        ::munmap(const_cast<char*>(data_), mapSize_);
+    }
+#endif
+    mapped_ = false;
+    mapSize_ = 0;
+    decoder_.reset();
+    releaseBuffer();
+    prefetch_.reset(); // An in-flight I/O task keeps the ring (and its file) alive until it finishes
+    data_ = nullptr;
+    begin_ = end_ = 0;
+    bufferOffset_ = 0;
+    eof_ = true;
+    resetScan();
+}
+
+bool FileReader::seek(uint64_t offset) {
+    if (mapped_) {
+        begin_ = static_cast<size_t>(std::min<uint64_t>(offset, end_));
+    }
+    else {
+        if (decoder_ ? !decoder_->seek(offset) : !file_ || !seekFile(file_, offset)) return false;
+        begin_ = end_ = 0;
+        bufferOffset_ = offset;
+        eof_ = false;
+    }
+    resetScan();
+    return true;
+}
+
+void FileReader::allocateBuffer(size_t size, BufferArena* arena) {
+    releaseBuffer();
+    if (arena && arena->blockSize() == size) buffer_ = arena->acquire();
+    if (buffer_) {
+        arena_ = arena;
+    }
+    else {
+        ownBuffer_.resize(size);
+        buffer_ = ownBuffer_.data();
+    }
+    capacity_ = size;
+}
+
+void FileReader::releaseBuffer() {
+    if (arena_) arena_->release(buffer_);
+    arena_ = nullptr;
+    buffer_ = nullptr;
+    capacity_ = 0;
+    std::vector<char>().swap(ownBuffer_);
+}
+
+void FileReader::resetScan() {
+    breaks_.clear();
+    nextBreak_ = 0;
+    scanned_ = begin_;
+    pendingComma_ = NO_COMMA;
+    lineComma_ = std::string_view::npos;
+}
+
+bool FileReader::nextLine(std::string_view& line) {
+    // Scan at most this much ahead at a time, so a mapped file is indexed incrementally
+    const size_t scanBlock = 1 << 16;
+    for (;;) {
+        size_t lineEnd;
+        size_t comma;
+        if (nextBreak_ < breaks_.size()) {
+            lineEnd = breaks_[nextBreak_].newline;
+            comma = breaks_[nextBreak_].firstComma;
+            ++nextBreak_;
+        }
+        else if (scanned_ < end_) {
+            breaks_.clear();
+            nextBreak_ = 0;
+            size_t to = std::min(end_, scanned_ + scanBlock);
+            scanLines(data_, scanned_, to, pendingComma_, breaks_);
+            scanned_ = to;
+            continue;
+        }
+        else if (eof_) {
+            if (begin_ == end_ || follow_) return false; // A follower waits for the newline
+            lineEnd = end_; // Last line without a trailing newline
+            comma = pendingComma_;
+            pendingComma_ = NO_COMMA;
+        }
+        else {
+            refill(0);
+            continue;
+        }
+
+        size_t length = lineEnd - begin_;
+        if (length > 0 && data_[lineEnd - 1] == '\r') --length; // Tolerate CRLF files
+        line = std::string_view(data_ + begin_, length);
+        lineComma_ = comma == NO_COMMA ? std::string_view::npos : comma - begin_;
+        begin_ = lineEnd < end_ ? lineEnd + 1 : end_;
+        return true;
+    }
+}
+
+bool FileReader::read(size_t count, std::string_view& bytes) {
+    if (scanned_ != begin_) resetScan(); // Fixed-size reads do not use the line index
+    while (end_ - begin_ < count) {
+        if (eof_) return false;
+        refill(count);
+    }
+    bytes = std::string_view(data_ + begin_, count);
+    begin_ += count;
+    scanned_ = begin_;
+    return true;
+}
+
+bool FileReader::failed() const {
+    if (decoder_) return decoder_->corrupt();
+    if (file_) return std::ferror(file_) != 0;
+    if (!prefetch_) return false;
+    std::lock_guard<std::mutex> lock(prefetch_->mutex);
+    return prefetch_->failed;
+}
+
+void FileReader::resume() {
+    if (!file_) return;
+    std::clearerr(file_);
+    eof_ = false;
+}
+
+void FileReader::refill(size_t need) {
+    if (begin_ > 0) {
+        // Only the unterminated line (already scanned up to end_) is kept, so the scan state just shifts
+        std::memmove(buffer_, buffer_ + begin_, end_ - begin_);
+        bufferOffset_ += begin_;
+        scanned_ -= begin_;
+        if (pendingComma_ != NO_COMMA) pendingComma_ -= begin_;
+        end_ -= begin_;
+        begin_ = 0;
+    }
+    if (end_ == capacity_ || capacity_ < need) {
+        // A single record larger than the buffer; an arena block is traded for a private buffer
+        size_t size = std::max(capacity_ * 2, need);
+        if (arena_) {
+            std::vector<char> grown(size);
+            std::memcpy(grown.data(), buffer_, end_);
+            releaseBuffer();
+            ownBuffer_ = std::move(grown);
+        }
+        else {
+            ownBuffer_.resize(size);
+        }
+        buffer_ = ownBuffer_.data();
+        capacity_ = size;
+        data_ = buffer_;
+    }
+    // Nothing past the end offset is taken in (a prefetch ring may have read some of it ahead)
+    uint64_t position = bufferOffset_ + end_;
+    size_t room = position >= endOffset_ ? 0 : static_cast<size_t>(std::min<uint64_t>(capacity_ - end_, endOffset_ - position));
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = room > 0 ? readMore(buffer_ + end_, room) : 0;
+    stallNanos_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    bytesRead_ += bytes;
+    if (readCounter_) readCounter_->fetch_add(bytes, std::memory_order_relaxed);
+    end_ += bytes;
+    if (bytes == 0) eof_ = true;
+}
+
+size_t FileReader::readMore(char* dest, size_t capacity) {
+    if (decoder_) return decoder_->read(dest, capacity);
+    if (!prefetch_) return std::fread(dest, 1, capacity, file_);
+
+    PrefetchRing& ring = *prefetch_;
+    std::unique_lock<std::mutex> lock(ring.mutex);
+    // Blocks are marked ready in file order and eof only after the last one, so an empty slot
+    // together with eof means the file is exhausted
+    ring.filled.wait(lock, [&ring] { return ring.ready[ring.consumeIndex] || ring.eof; });
+    if (!ring.ready[ring.consumeIndex]) return 0;
+
+    // Take as much of the next block as fits; a partly consumed block stays at the front of the ring
+    size_t index = ring.consumeIndex;
+    size_t bytes = std::min(capacity, ring.sizes[index]);
+    std::vector<char>& block = ring.blocks[index];
+    std::memcpy(dest, block.data(), bytes);
+    if (bytes < ring.sizes[index]) {
+        std::memmove(block.data(), block.data() + bytes, ring.sizes[index] - bytes);
+        ring.sizes[index] -= bytes;
+    }
+    else {
+        ring.ready[index] = 0;
+        ring.consumeIndex = (index + 1) % ring.blocks.size();
+        PrefetchRing::schedule(prefetch_);
+    }
+    return bytes;
+}
@@ -0,0 +1,145 @@
+// file_reader.h
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "line_scanner.h"
+
+// How a FileReader gets at file contents
+enum class IoMode {
+    Stream, // Buffered reads into a private buffer
+    Mmap    // Read-only mapping of the whole file, scanned in place (POSIX only; falls back to Stream)
+};
+
+class BufferArena;
+class Decompressor;
+class ThreadPool;
+
+// How FileReader::open() reads a file
+struct ReadOptions {
+    static const size_t DEFAULT_BUFFER_SIZE = 1 << 16;
+
+    IoMode mode = IoMode::Stream;
+    size_t bufferSize = DEFAULT_BUFFER_SIZE; // Read buffer (and prefetch block) size in stream mode
+    BufferArena* arena = nullptr;            // Stream mode: take the read buffer from here if it has a free
+                                             // block of bufferSize bytes (else it is allocated)
+    ThreadPool* prefetchPool = nullptr;      // Stream mode: read blocks ahead on these I/O threads
+    size_t prefetchDepth = 2;                // Blocks kept read ahead per file when prefetching
+    uint64_t startOffset = 0; // Start reading at this byte offset instead of the beginning
+    uint64_t endOffset = UINT64_MAX; // Not follow mode: the file ends here, whatever is appended later
+    std::atomic<uint64_t>* readCounter = nullptr; // Also add bytes here as they are read, for live progress
+    bool follow = false; // Stream mode, no prefetch: the file may still grow, so an unterminated
+                         // last line is held back and resume() picks up appended data
+};
+
+// Reads a file sequentially through one large buffer (or a memory mapping), either line by line
+// or in fixed-size chunks. Results are views into that memory, so no per-record allocation takes place.
+// Files named "*.gz" / "*.zst" are decompressed as they are read (see decompressor.h), always in
+// stream mode; offsets are then positions in the uncompressed data. With a prefetch pool the I/O
+// threads decompress, so that work overlaps the merge the same way reads do.
+class FileReader {
+public:
+    FileReader() = default;
+    ~FileReader();
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+    FileReader(FileReader&& other) noexcept;
+    FileReader& operator=(FileReader&& other) noexcept;
+
+    bool open(const std::string& path, const ReadOptions& options = ReadOptions());
+    bool isOpen() const { return file_ != nullptr || decoder_ || mapped_ || prefetch_; }
+    void close();
+
+    // Advances to the next line (without the line terminator). The view stays valid
+    // until the next call to nextLine(), read() or close().
+    bool nextLine(std::string_view& line);
+
+    // Offset of the first ',' in the line last returned by nextLine(), or npos. Comes from the
+    // same vectorized scan that finds line ends, so callers need not search the line again.
+    size_t lineComma() const { return lineComma_; }
+
+    // Consumes exactly 'count' bytes; false (consuming nothing) if fewer remain. Same view lifetime as nextLine().
+    bool read(size_t count, std::string_view& bytes);
+
+    // Byte offset in the file of the next unconsumed byte
+    uint64_t tell() const { return bufferOffset_ + begin_; }
+
+    // Continues reading at byte 'offset' (clamped to the end of a mapping). Not available with
+    // prefetching, where the I/O threads own the file position; returns false then. Compressed
+    // files without a seek table get there by decoding, so seeking them is slow.
+    bool seek(uint64_t offset);
+
+    // Forgets that end of file was reached (stream mode), so the next nextLine() reads anything
+    // appended since
+    void resume();
+
+    // Leaves follow mode, so an unterminated last line is returned once the end is reached
+    void stopFollowing() { follow_ = false; }
+
+    // True once the file could not be read on: a read error, or corrupt or truncated compressed
+    // data. What came before was returned and the rest reads as end of file.
+    bool failed() const;
+
+    // I/O counters since open(): bytes brought into memory, and time spent waiting for them. A
+    // mapped file counts as read once mapped, and its page faults are not timed.
+    uint64_t bytesRead() const { return bytesRead_; }
+    uint64_t stallNanos() const { return stallNanos_; }
+
+private:
+    std::FILE* file_ = nullptr;
+    std::unique_ptr<Decompressor> decoder_; // Compressed file read without prefetching
+    std::vector<char> ownBuffer_;
+    char* buffer_ = nullptr;         // Stream mode: an arena block, or ownBuffer_.data()
+    size_t capacity_ = 0;            // Size of buffer_
+    BufferArena* arena_ = nullptr;   // Owner of buffer_ while it is an arena block
+    const char* data_ = nullptr; // buffer_ in stream mode, the mapping in mmap mode
+    size_t begin_ = 0;           // Start of unconsumed data
+    size_t end_ = 0;             // End of valid data
+    uint64_t bufferOffset_ = 0;  // File offset of data_[0]
+    bool eof_ = false;
+    bool follow_ = false;        // Opened with ReadOptions::follow
+    bool mapped_ = false;        // data_ is a mapping of mapSize_ bytes
+    size_t mapSize_ = 0;
+    uint64_t endOffset_ = UINT64_MAX; // ReadOptions::endOffset
+    uint64_t bytesRead_ = 0;
+    uint64_t stallNanos_ = 0;
+    std::atomic<uint64_t>* readCounter_ = nullptr; // ReadOptions::readCounter
+
+    // Line index from scanLines(): breaks_[nextBreak_..] are complete lines not yet returned,
+    // and data up to scanned_ has been scanned
+    std::vector<LineBreak> breaks_;
+    size_t nextBreak_ = 0;
+    size_t scanned_ = 0;
+    size_t pendingComma_ = NO_COMMA; // First comma of the partly scanned line
+    size_t lineComma_ = std::string_view::npos;
+
+    void resetScan();
+
+    // Points buffer_ at 'size' bytes from 'arena' or, failing that, at ownBuffer_
+    void allocateBuffer(size_t size, BufferArena* arena);
+
+    // Returns an arena block and drops ownBuffer_
+    void releaseBuffer();
+
+    // Read-ahead ring shared with the I/O thread filling it (see file_reader.cpp)
+    struct PrefetchRing;
+    std::shared_ptr<PrefetchRing> prefetch_;
+
+    bool openMapped(const std::string& path, uint64_t startOffset, uint64_t endOffset);
+
+    // Appends up to 'capacity' bytes at 'dest' from the file or the prefetch ring; returns the count
+    size_t readMore(char* dest, size_t capacity);
+
+    // Moves unconsumed bytes to the front of the buffer, grows it to hold at least 'need' bytes
+    // (and at least one more than it holds now), and reads more
+    void refill(size_t need);
+};
+
+#endif // FILE_READER_H
@@ -0,0 +1,52 @@
+// file_watcher.cpp
+#include "file_watcher.h"
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+void FileWatcher::watch(const std::string& dir) {
+#ifdef __linux__
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ >= 0 && ::inotify_add_watch(fd_, dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+        ::close(fd_);
+        fd_ = -1; // Fall back to polling
+    }
+#else
+    (void)dir;
+#endif
+}
+
+bool FileWatcher::wait(int timeoutMillis, std::vector<std::string>& changed) {
+#ifdef __linux__
+    if (fd_ >= 0) {
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, timeoutMillis) <= 0) return true; // Timeout or signal: nothing changed
+
+        alignas(struct inotify_event) char buffer[16384];
+        for (;;) {
+            ssize_t length = ::read(fd_, buffer, sizeof(buffer));
+            if (length <= 0) return true; // Queue drained
+            for (ssize_t offset = 0; offset < length;) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+                if (event->mask & IN_Q_OVERFLOW) return false;
+                if (event->len > 0) changed.push_back(event->name);
+                offset += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMillis));
+    return false;
+}
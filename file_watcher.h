@@ -0,0 +1,29 @@
+// file_watcher.h
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <vector>
+
+// Waits for files in one directory to be written to. Uses inotify on Linux; elsewhere (or when
+// inotify is unavailable) a wait just sleeps and reports that any file may have changed.
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    void watch(const std::string& dir);
+
+    // Waits up to 'timeoutMillis' (returning early on a change or a signal) and appends the names,
+    // without directory, of files modified meanwhile to 'changed'. Returns false when the changed
+    // set is unknown (polling fallback, or the kernel dropped events), so every file must be checked.
+    bool wait(int timeoutMillis, std::vector<std::string>& changed);
+
+private:
+    int fd_ = -1;
+};
+
+#endif // FILE_WATCHER_H
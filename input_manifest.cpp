@@ -0,0 +1,142 @@
+// input_manifest.cpp
+#include "input_manifest.h"
+#include "sparse_index.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char MAGIC[8] = {'M', 'D', 'M', 'M', 'A', 'N', '0', '1'};
+
+// Coarsest directory mtime resolution in common use (FAT); other filesystems tick at least as fast
+const auto MTIME_GRANULARITY = std::chrono::seconds(2);
+
+struct ManifestHeader {
+    char magic[8];
+    int64_t dirMtime; // When the listing was taken; patched in last, see save(). 0 = not current
+    uint64_t count;
+    uint64_t columnsSize; // The schema's header line follows the header
+};
+
+struct EntryHeader {
+    uint64_t size;
+    int64_t mtime;
+    int64_t firstTimestamp;
+    int64_t lastTimestamp;
+    uint64_t scanned;
+    uint64_t nameSize; // The name follows
+};
+
+bool directoryMtime(const std::string& dir, int64_t& mtime) {
+    std::error_code error;
+    auto time = fs::last_write_time(dir, error);
+    if (error) return false;
+    mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+// Whether a change made later than 'mtime' is sure to give the directory another mtime
+bool settled(int64_t mtime) {
+    fs::file_time_type time{fs::file_time_type::duration(mtime)};
+    return fs::file_time_type::clock::now() - time >= MTIME_GRANULARITY;
+}
+
+bool readString(std::FILE* file, uint64_t size, std::string& text) {
+    if (size > (1 << 16)) return false; // Longer than any file name or header line
+    text.resize(static_cast<size_t>(size));
+    return size == 0 || std::fread(&text[0], 1, text.size(), file) == text.size();
+}
+
+} // namespace
+
+std::string InputManifest::pathFor(const std::string& inputDir) {
+    return (fs::path(inputDir) / ".mdm_manifest").string();
+}
+
+bool InputManifest::load(const std::string& inputDir, std::string_view columns) {
+    entries.clear();
+    current_ = false;
+    std::FILE* file = std::fopen(pathFor(inputDir).c_str(), "rb");
+    if (!file) return false;
+    ManifestHeader header;
+    std::string text;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+              readString(file, header.columnsSize, text) && text == columns;
+    for (uint64_t i = 0; ok && i < header.count; ++i) {
+        EntryHeader entry;
+        ManifestEntry loaded;
+        ok = std::fread(&entry, sizeof(entry), 1, file) == 1 && readString(file, entry.nameSize, loaded.name);
+        loaded.size = entry.size;
+        loaded.mtime = entry.mtime;
+        loaded.firstTimestamp = entry.firstTimestamp;
+        loaded.lastTimestamp = entry.lastTimestamp;
+        loaded.scanned = entry.scanned != 0;
+        if (ok) entries.push_back(std::move(loaded));
+    }
+    std::fclose(file);
+    if (!ok) {
+        entries.clear();
+        return false;
+    }
+    int64_t mtime;
+    listedMtime_ = header.dirMtime;
+    current_ = listedMtime_ != 0 && directoryMtime(inputDir, mtime) && mtime == listedMtime_ && settled(mtime);
+    return true;
+}
+
+int64_t InputManifest::listingMtime(const std::string& inputDir) {
+    int64_t mtime;
+    return directoryMtime(inputDir, mtime) && settled(mtime) ? mtime : 0;
+}
+
+bool InputManifest::save(const std::string& inputDir, std::string_view columns, int64_t listedMtime) const {
+    // Rewriting the manifest in place keeps the directory's mtime; only creating it changes that.
+    // Readers meanwhile see a manifest that is damaged or not current, and list the directory.
+    std::string path = pathFor(inputDir);
+    std::string temp;
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    if (!file) {
+        temp = SparseIndex::tempPathFor(path);
+        file = std::fopen(temp.c_str(), "wb");
+        if (!file) return false;
+    }
+    ManifestHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.dirMtime = 0; // Not current until the listing is confirmed below
+    header.count = entries.size();
+    header.columnsSize = columns.size();
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(columns.data(), 1, columns.size(), file) == columns.size();
+    for (size_t i = 0; ok && i < entries.size(); ++i) {
+        const ManifestEntry& entry = entries[i];
+        EntryHeader written{entry.size, entry.mtime, entry.firstTimestamp, entry.lastTimestamp, entry.scanned ? 1u : 0u,
+                            entry.name.size()};
+        ok = std::fwrite(&written, sizeof(written), 1, file) == 1 &&
+             std::fwrite(entry.name.data(), 1, entry.name.size(), file) == entry.name.size();
+    }
+    long size = ok ? std::ftell(file) : -1;
+    ok = std::fclose(file) == 0 && ok && size >= 0;
+    std::error_code error;
+    if (temp.empty()) {
+        if (ok) fs::resize_file(path, static_cast<uintmax_t>(size), error); // Drop a longer old tail
+        if (!ok || error) return false;
+
+        // Confirm the listing only if nothing was added, removed or renamed since it was taken
+        int64_t mtime;
+        if (listedMtime == 0 || !directoryMtime(inputDir, mtime) || mtime != listedMtime) return true;
+        header.dirMtime = listedMtime;
+        file = std::fopen(path.c_str(), "r+b");
+        if (!file) return false;
+        ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        return std::fclose(file) == 0 && ok;
+    }
+    if (ok) fs::rename(temp, path, error);
+    if (!ok || error) {
+        fs::remove(temp, error);
+        return false;
+    }
+    return true; // The rename changed the directory's mtime, so this listing stays unconfirmed
+}
@@ -0,0 +1,57 @@
+// input_manifest.h
+#ifndef INPUT_MANIFEST_H
+#define INPUT_MANIFEST_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One input file as of the run that last looked at it
+struct ManifestEntry {
+    std::string name; // File name within the input directory
+    uint64_t size = 0;
+    int64_t mtime = 0; // As SparseIndex::stat() reports it; size and mtime 0 = never examined
+    bool scanned = false; // firstTimestamp and lastTimestamp were looked for (windowed runs only)
+    int64_t firstTimestamp = INT64_MIN; // Key timestamps of the first and last data rows; these
+    int64_t lastTimestamp = INT64_MAX;  // defaults mean unknown (the file may hold any time)
+};
+
+// Cached listing of an input directory, kept as "<input_dir>/.mdm_manifest" so that a run over
+// tens of thousands of inputs need not list, filter and sort the directory again. The listing is
+// current while the directory's mtime is the one sampled just before it was taken (nothing added,
+// removed or renamed since); each entry is then revalidated on its own with one stat. Like sidecar
+// indexes it is a local cache, written in native byte order, and a read-only input directory just
+// goes without one.
+class InputManifest {
+public:
+    static std::string pathFor(const std::string& inputDir);
+
+    // Loads the manifest of 'inputDir' written for rows with header 'columns'; false if it is
+    // missing or damaged, or was written for another schema
+    bool load(const std::string& inputDir, std::string_view columns);
+
+    // Directory mtime to sample before listing 'inputDir', for save(). 0 (not trusted) if it lies
+    // within MTIME_GRANULARITY of now: a file created later in the same tick would not change it.
+    static int64_t listingMtime(const std::string& inputDir);
+
+    // Writes the manifest, marked current for 'listedMtime' (from listingMtime() or, for a listing
+    // that was not taken again, listedMtime()) if the directory still has that mtime. An existing
+    // manifest is rewritten in place, which leaves the directory's mtime alone; a new one (temp file
+    // + rename) changes it, so the next run lists again. False on failure.
+    bool save(const std::string& inputDir, std::string_view columns, int64_t listedMtime) const;
+
+    // Whether the loaded listing still matches the directory
+    bool current() const { return current_; }
+
+    // Directory mtime the loaded listing was taken at (0 = never confirmed)
+    int64_t listedMtime() const { return listedMtime_; }
+
+    std::vector<ManifestEntry> entries; // Sorted by name
+
+private:
+    bool current_ = false;
+    int64_t listedMtime_ = 0;
+};
+
+#endif // INPUT_MANIFEST_H
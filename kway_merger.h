@@ -0,0 +1,159 @@
+// kway_merger.h
+#ifndef KWAY_MERGER_H
+#define KWAY_MERGER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Selection structure used by KWayMerger
+enum class MergeKernel {
+    LoserTree, // Tournament tree: one leaf-to-root replay (~log2(k) comparisons) per record
+    Heap       // Binary heap of source indices: pop + push per record
+};
+
+// K-way merge over a set of sorted sources. A Source must provide:
+//   bool next();             // Loads its next record; false once exhausted
+//   const Key& key() const;  // Key of the current record (valid after next() returned true)
+// Keys are ordered with operator<; ties are broken by source index so output is deterministic.
+// Once a source wins twice in a row the kernel remembers the runner-up, and while that source's
+// next record still beats it the record is taken without touching the tree or heap (one
+// comparison instead of ~log2(k)), which makes bursts of one symbol cheap.
+template <typename Key, typename Source>
+class KWayMerger {
+public:
+    KWayMerger(std::vector<Source>& sources, MergeKernel kernel = MergeKernel::LoserTree)
+        : sources_(sources), kernel_(kernel), live_(sources.size(), 0) {
+        for (size_t i = 0; i < sources_.size(); ++i) {
+            live_[i] = sources_[i].next() ? 1 : 0;
+        }
+        if (kernel_ == MergeKernel::LoserTree) {
+            buildTree();
+        }
+        else {
+            for (size_t i = 0; i < sources_.size(); ++i) {
+                if (live_[i]) heap_.push_back(i);
+            }
+            std::make_heap(heap_.begin(), heap_.end(), HeapOrder{this});
+        }
+    }
+
+    bool empty() const {
+        if (kernel_ == MergeKernel::LoserTree) return sources_.empty() || !live_[tree_[0]];
+        return heap_.empty();
+    }
+
+    // Index of the source holding the smallest current record; only valid when !empty()
+    size_t topIndex() const {
+        return kernel_ == MergeKernel::LoserTree ? tree_[0] : heap_.front();
+    }
+
+    Source& top() { return sources_[topIndex()]; }
+
+    // Records advanced through the kernel, and key comparisons made so far
+    uint64_t operations() const { return operations_; }
+    uint64_t comparisons() const { return comparisons_; }
+
+    // Advances the winning source to its next record and restores the merge order
+    void advance() {
+        size_t winner = topIndex();
+        ++operations_;
+        live_[winner] = sources_[winner].next() ? 1 : 0;
+        if (runnerUp_ != NONE) {
+            // Still ahead of every other source, so the tree or heap already has it on top
+            if (live_[winner] && less(winner, runnerUp_)) return;
+            runnerUp_ = NONE;
+        }
+        if (kernel_ == MergeKernel::LoserTree) {
+            replay(winner);
+        }
+        else {
+            std::pop_heap(heap_.begin(), heap_.end(), HeapOrder{this});
+            if (live_[winner]) {
+                std::push_heap(heap_.begin(), heap_.end(), HeapOrder{this});
+            }
+            else {
+                heap_.pop_back();
+            }
+        }
+        if (live_[winner] && topIndex() == winner) runnerUp_ = findRunnerUp(winner);
+    }
+
+private:
+    std::vector<Source>& sources_;
+    MergeKernel kernel_;
+    std::vector<char> live_;     // Whether source i currently holds a record
+    std::vector<size_t> tree_;   // Loser tree: tree_[0] is the winner, tree_[1..k-1] the losers
+    std::vector<size_t> heap_;   // Heap kernel: indices of live sources
+    static const size_t NONE = SIZE_MAX;
+    size_t runnerUp_ = NONE;     // Best source other than the winner, while the winner is on a streak
+    uint64_t operations_ = 0;
+    mutable uint64_t comparisons_ = 0;
+
+    // Strict order on sources; exhausted sources compare greater than every live one
+    bool less(size_t a, size_t b) const {
+        if (!live_[b]) return live_[a] || a < b;
+        if (!live_[a]) return false;
+        ++comparisons_;
+        const Key& ka = sources_[a].key();
+        const Key& kb = sources_[b].key();
+        if (ka < kb) return true;
+        if (kb < ka) return false;
+        return a < b;
+    }
+
+    struct HeapOrder {
+        const KWayMerger* merger;
+        bool operator()(size_t a, size_t b) const { return merger->less(b, a); } // Max-heap on reversed order
+    };
+
+    void buildTree() {
+        size_t k = sources_.size();
+        tree_.assign(std::max<size_t>(k, 1), 0);
+        if (k <= 1) return;
+        // Leaf i sits at position k + i; play every match bottom-up, keeping losers in place
+        std::vector<size_t> winners(2 * k);
+        for (size_t i = 0; i < k; ++i) winners[k + i] = i;
+        for (size_t node = k - 1; node >= 1; --node) {
+            size_t a = winners[2 * node];
+            size_t b = winners[2 * node + 1];
+            if (less(a, b)) {
+                winners[node] = a;
+                tree_[node] = b;
+            }
+            else {
+                winners[node] = b;
+                tree_[node] = a;
+            }
+        }
+        tree_[0] = winners[1];
+    }
+
+    // Second-best source behind 'winner' (the top): the best of the losers on its path to the
+    // root, or the better child of the heap root; NONE if no other source is live
+    size_t findRunnerUp(size_t winner) const {
+        size_t best = NONE;
+        auto consider = [&](size_t candidate) {
+            if (live_[candidate] && (best == NONE || less(candidate, best))) best = candidate;
+        };
+        if (kernel_ == MergeKernel::LoserTree) {
+            for (size_t node = (sources_.size() + winner) / 2; node >= 1; node /= 2) consider(tree_[node]);
+        }
+        else {
+            for (size_t child = 1; child <= 2 && child < heap_.size(); ++child) consider(heap_[child]);
+        }
+        return best;
+    }
+
+    // Replays the matches on the path from 'winner's leaf to the root
+    void replay(size_t winner) {
+        size_t k = sources_.size();
+        for (size_t node = (k + winner) / 2; node >= 1; node /= 2) {
+            if (less(tree_[node], winner)) std::swap(tree_[node], winner);
+        }
+        tree_[0] = winner;
+    }
+};
+
+#endif // KWAY_MERGER_H
@@ -0,0 +1,106 @@
+// line_scanner.cpp
+#include "line_scanner.h"
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LINE_SCANNER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LINE_SCANNER_NEON 1
+#endif
+
+namespace {
+
+#if defined(_MSC_VER) && !defined(__clang__)
+inline unsigned lowestBit(uint64_t mask) {
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+}
+#else
+inline unsigned lowestBit(uint64_t mask) {
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+}
+#endif
+
+// Emits the events of one chunk at 'base': bit i of 'newlines'/'commas' marks data[base + i]
+inline void emitChunk(size_t base, uint64_t newlines, uint64_t commas, size_t& pendingComma,
+                      std::vector<LineBreak>& out) {
+    while (newlines) {
+        unsigned nl = lowestBit(newlines);
+        uint64_t before = commas & ((uint64_t(1) << nl) - 1); // Commas on this line, ahead of its '\n'
+        if (pendingComma == NO_COMMA && before) pendingComma = base + lowestBit(before);
+        out.push_back({base + nl, pendingComma});
+        pendingComma = NO_COMMA;
+        commas &= ~((uint64_t(2) << nl) - 1);
+        newlines &= newlines - 1;
+    }
+    if (pendingComma == NO_COMMA && commas) pendingComma = base + lowestBit(commas);
+}
+
+// Masks of '\n' and ',' for the 'Width' bytes at p
+#if defined(__AVX2__)
+const size_t Width = 32;
+inline void chunkMasks(const char* p, uint64_t& newlines, uint64_t& commas) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+    commas = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+}
+#elif defined(LINE_SCANNER_SSE2)
+const size_t Width = 16;
+inline void chunkMasks(const char* p, uint64_t& newlines, uint64_t& commas) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    newlines = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    commas = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+}
+#elif defined(LINE_SCANNER_NEON)
+const size_t Width = 16;
+inline uint64_t neonMask(uint8x16_t matches) {
+    // Narrow each 0x00/0xFF byte to a nibble, giving 4 bits per byte; keep one bit of each nibble
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+    uint64_t wide = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x1111111111111111ULL;
+    uint64_t mask = 0;
+    for (unsigned i = 0; wide; ++i, wide >>= 4) mask |= (wide & 1) << i;
+    return mask;
+}
+inline void chunkMasks(const char* p, uint64_t& newlines, uint64_t& commas) {
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    newlines = neonMask(vceqq_u8(v, vdupq_n_u8('\n')));
+    commas = neonMask(vceqq_u8(v, vdupq_n_u8(',')));
+}
+#else
+const size_t Width = 8;
+inline void chunkMasks(const char* p, uint64_t& newlines, uint64_t& commas) {
+    newlines = commas = 0;
+    for (unsigned i = 0; i < Width; ++i) {
+        newlines |= uint64_t(p[i] == '\n') << i;
+        commas |= uint64_t(p[i] == ',') << i;
+    }
+}
+#endif
+
+} // namespace
+
+void scanLines(const char* data, size_t from, size_t to, size_t& pendingComma, std::vector<LineBreak>& out) {
+    size_t pos = from;
+    for (; pos + Width <= to; pos += Width) {
+        uint64_t newlines, commas;
+        chunkMasks(data + pos, newlines, commas);
+        if (newlines | commas) emitChunk(pos, newlines, commas, pendingComma, out);
+    }
+
+    // Tail shorter than one vector
+    uint64_t newlines = 0, commas = 0;
+    for (size_t i = 0; pos + i < to; ++i) {
+        newlines |= uint64_t(data[pos + i] == '\n') << i;
+        commas |= uint64_t(data[pos + i] == ',') << i;
+    }
+    if (newlines | commas) emitChunk(pos, newlines, commas, pendingComma, out);
+}
@@ -0,0 +1,22 @@
+// line_scanner.h
+#ifndef LINE_SCANNER_H
+#define LINE_SCANNER_H
+
+#include <cstddef>
+#include <vector>
+
+// Position of one line terminator found by scanLines()
+struct LineBreak {
+    size_t newline;    // Offset of the '\n'
+    size_t firstComma; // Offset of the first ',' on that line, or NO_COMMA
+};
+
+const size_t NO_COMMA = static_cast<size_t>(-1);
+
+// Finds every '\n' in data[from, to) together with the first ',' of each line in a single
+// vectorized pass (AVX2, SSE2 or NEON where the compiler targets them, scalar otherwise).
+// 'pendingComma' carries the first comma of the unterminated line across calls: pass NO_COMMA at
+// the start of a line, and the value left by the previous call when continuing one.
+void scanLines(const char* data, size_t from, size_t to, size_t& pendingComma, std::vector<LineBreak>& out);
+
+#endif // LINE_SCANNER_H
@@ -1,20 +1,121 @@
 // main.cpp
+#include "columnar_file.h"
 #include "market_data_merger.h"
+#include <algorithm>
+#include <csignal>
 #include <iostream>
+#include <string>
+#include <vector>
 
-int main(int argc, char* argv[]) {
-   if (argc != 4) {
-       std::cerr << "Usage: " << argv[0] << " <input_dir> <temp_dir> <output_file>" << std::endl;
+static void printUsage(const char* program) {
+   std::cerr << "Usage: " << program << " [--schema ticks|l2-deltas] [--threads N] [--partitions P] [--kernel loser-tree|heap]"
+                " [--io=stream|mmap] [--prefetch THREADS] [--memory-budget MIB] [--metrics FILE] [--progress SECONDS]"
+                " [--from TIME] [--to TIME] [--symbols A,B,...] [--dedup] [--conflate MILLIS] [--typed]"
+                " [--output-format=csv|columnar [--chunk-rows N]] [--bars INTERVAL] [--append]"
+                " [--follow [--follow-idle SECONDS]] [--resume]"
+                " [--no-index] [--index-interval KB] [--no-manifest] <input_dir> <temp_dir> <output_file>\n"
+             << "       " << program << " index [--threads N] [--symbols A,B,...] [--index-interval KB] <input_dir>\n"
+             << "       " << program << " worker --coordinator HOST:PORT [--threads N] [--kernel ...] [--io=...] [--prefetch THREADS]"
+                " [--memory-budget MIB] [--from TIME] [--to TIME] [--symbols A,B,...] [--dedup] [--conflate MILLIS]"
+                " <input_dir> <temp_dir>\n"
+             << "       " << program << " coordinator --listen PORT --workers N [--kernel ...] [--metrics FILE] [--progress SECONDS]"
+                " [--typed] [--output-format=csv|columnar [--chunk-rows N]] [--bars INTERVAL] <output_file>\n"
+             << "       " << program << " --convert-to-csv <columnar_file> <output_file>" << std::endl;
+}
+
+// Parses a --from/--to bound: a timestamp as in the data, with 'T' allowed between date and
+// time, or a bare date meaning its midnight
+static bool parseBound(std::string text, int64_t& nanos) {
+   if (text.size() == 10) text += " 00:00:00";
+   if (text.size() > 10 && text[10] == 'T') text[10] = ' ';
+   return parseTimestamp(text, nanos);
+}
+
+// Parses a --bars interval: a whole number of milliseconds, seconds, minutes or hours ("250ms", "1m")
+static bool parseInterval(const std::string& text, int64_t& nanos) {
+   size_t digits = 0;
+   while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9') ++digits;
+   if (digits == 0 || digits > 9) return false;
+   std::string unit = text.substr(digits);
+   int64_t scale = unit == "ms" ? 1000000
+                 : unit == "s"  ? 1000000000
+                 : unit == "m"  ? 60000000000
+                 : unit == "h"  ? 3600000000000
+                                : 0;
+   nanos = std::stoll(text.substr(0, digits)) * scale;
+   return nanos > 0;
+}
+
+static void onStopSignal(int) {
+   MarketDataMerger::stopFollowing(); // Stops a follow run of any schema
+}
+
+// Runs the parsed command on a merger for rows of 'Schema'
+template <typename Schema>
+static int runCommand(const char* program, const std::string& command, const std::vector<std::string>& positional,
+                      const MergeOptions& options, const std::string& coordinatorAddress, unsigned long listenPort,
+                      size_t workers) {
+   if (command == "index") {
+       if (positional.size() != 1) {
+           printUsage(program);
+           return 1;
+       }
+       try {
+           BasicMarketDataMerger<Schema> merger(positional[0], "", "", options);
+           std::cout << "Indexed " << merger.buildIndexes() << " files." << std::endl;
+       }
+       catch (const std::exception& e) {
+           std::cerr << "Error: " << e.what() << std::endl;
+           return 1;
+       }
+       return 0;
+   }
+
+   if (command == "worker" || command == "coordinator") {
+       bool worker = command == "worker";
+       if (worker ? positional.size() != 2 || coordinatorAddress.empty()
+                  : positional.size() != 1 || workers == 0 || listenPort == 0 || listenPort > 65535) {
+           printUsage(program);
+           return 1;
+       }
+       try {
+           bool ok;
+           if (worker) {
+               BasicMarketDataMerger<Schema> merger(positional[0], positional[1], "", options);
+               ok = merger.mergeToCoordinator(coordinatorAddress);
+           }
+           else {
+               BasicMarketDataMerger<Schema> merger("", "", positional[0], options);
+               ok = merger.mergeFromWorkers(static_cast<uint16_t>(listenPort), workers);
+           }
+           if (!ok) return 1;
+           std::cout << (worker ? "Worker" : "Coordinator") << " merge completed successfully." << std::endl;
+       }
+       catch (const std::exception& e) {
+           std::cerr << "Error: " << e.what() << std::endl;
+           return 1;
+       }
+       return 0;
+   }
+
+   if (positional.size() != 3) {
+       printUsage(program);
        return 1;
    }
 
-   std::string inputDir = argv[1];
-   std::string tempDir = argv[2];
-   std::string outputFile = argv[3];
+   std::string inputDir = positional[0];
+   std::string tempDir = positional[1];
+   std::string outputFile = positional[2];
+
+   if (options.follow) {
+       // Ctrl-C / SIGTERM end a follow run cleanly: buffered rows are emitted and the output closed
+       std::signal(SIGINT, onStopSignal);
+       std::signal(SIGTERM, onStopSignal);
+   }
 
    try {
-       MarketDataMerger merger(inputDir, tempDir, outputFile);
-       merger.merge();
+       BasicMarketDataMerger<Schema> merger(inputDir, tempDir, outputFile, options);
+       if (!merger.merge()) return 1;
        std::cout << "Merging completed successfully." << std::endl;
    }
    catch (const std::exception& e) {
@@ -23,4 +124,170 @@ int main(int argc, char* argv[]) {
    }
 
    return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+   MergeOptions options;
+   std::vector<std::string> positional;
+   bool convertToCsv = false;
+   std::string command = argc > 1 ? argv[1] : "";
+   bool indexOnly = command == "index";
+   bool worker = command == "worker";
+   bool coordinator = command == "coordinator";
+   std::string coordinatorAddress;
+   unsigned long listenPort = 0;
+   size_t workers = 0;
+
+   std::string schema = "ticks";
+   if (!indexOnly && !worker && !coordinator) command.clear();
+
+   try {
+       for (int i = indexOnly || worker || coordinator ? 2 : 1; i < argc; ++i) {
+           std::string arg = argv[i];
+           if (arg == "--threads" && i + 1 < argc) {
+               options.threads = std::stoul(argv[++i]);
+           }
+           else if (arg == "--partitions" && i + 1 < argc) {
+               options.partitions = std::stoul(argv[++i]);
+           }
+           else if (arg == "--kernel" && i + 1 < argc) {
+               std::string kernel = argv[++i];
+               if (kernel == "loser-tree") options.kernel = MergeKernel::LoserTree;
+               else if (kernel == "heap") options.kernel = MergeKernel::Heap;
+               else {
+                   std::cerr << "Unknown merge kernel: " << kernel << std::endl;
+                   return 1;
+               }
+           }
+           else if (arg == "--prefetch" && i + 1 < argc) {
+               options.prefetchThreads = std::stoul(argv[++i]);
+           }
+           else if (arg == "--memory-budget" && i + 1 < argc) {
+               options.memoryBudget = static_cast<size_t>(std::stoull(argv[++i])) << 20;
+           }
+           else if (arg == "--metrics" && i + 1 < argc) {
+               options.metricsFile = argv[++i];
+           }
+           else if (arg == "--progress" && i + 1 < argc) {
+               options.progressSeconds = std::stod(argv[++i]);
+           }
+           else if ((arg == "--from" || arg == "--to") && i + 1 < argc) {
+               int64_t& bound = arg == "--from" ? options.window.from : options.window.to;
+               if (!parseBound(argv[++i], bound)) {
+                   std::cerr << "Invalid " << arg << " timestamp: " << argv[i] << std::endl;
+                   return 1;
+               }
+           }
+           else if (arg == "--symbols" && i + 1 < argc) {
+               std::string list = argv[++i];
+               for (size_t start = 0; start <= list.size();) {
+                   size_t comma = std::min(list.find(',', start), list.size());
+                   if (comma > start) options.symbols.push_back(list.substr(start, comma - start));
+                   start = comma + 1;
+               }
+           }
+           else if (arg == "--output-format=csv") {
+               options.outputFormat = OutputFormat::Csv;
+           }
+           else if (arg == "--output-format=columnar") {
+               options.outputFormat = OutputFormat::Columnar;
+           }
+           else if (arg == "--bars" && i + 1 < argc) {
+               if (!parseInterval(argv[++i], options.barNanos)) {
+                   std::cerr << "Invalid --bars interval: " << argv[i] << std::endl;
+                   return 1;
+               }
+               options.outputFormat = OutputFormat::Bars;
+           }
+           else if (arg == "--chunk-rows" && i + 1 < argc) {
+               options.chunkRows = std::stoul(argv[++i]);
+           }
+           else if (arg == "--convert-to-csv") {
+               convertToCsv = true;
+           }
+           else if (arg == "--typed") {
+               options.typed = true;
+           }
+           else if (arg == "--dedup") {
+               options.dedup = true;
+           }
+           else if (arg == "--conflate" && i + 1 < argc) {
+               options.conflateNanos = static_cast<int64_t>(std::stod(argv[++i]) * 1e6);
+           }
+           else if (arg == "--append") {
+               options.append = true;
+           }
+           else if (arg == "--follow") {
+               options.follow = true;
+           }
+           else if (arg == "--follow-idle" && i + 1 < argc) {
+               options.followIdleSeconds = std::stod(argv[++i]);
+           }
+           else if (arg == "--no-index") {
+               options.useIndex = false;
+           }
+           else if (arg == "--no-manifest") {
+               options.useManifest = false;
+           }
+           else if (arg == "--resume") {
+               options.resume = true;
+           }
+           else if (arg == "--index-interval" && i + 1 < argc) {
+               options.indexInterval = std::stoull(argv[++i]) * 1024;
+           }
+           else if (arg == "--coordinator" && worker && i + 1 < argc) {
+               coordinatorAddress = argv[++i];
+           }
+           else if (arg == "--listen" && coordinator && i + 1 < argc) {
+               listenPort = std::stoul(argv[++i]);
+           }
+           else if (arg == "--workers" && coordinator && i + 1 < argc) {
+               workers = std::stoul(argv[++i]);
+           }
+           else if (arg == "--schema" && i + 1 < argc) {
+               schema = argv[++i];
+           }
+           else if (arg == "--io=stream") {
+               options.io = IoMode::Stream;
+           }
+           else if (arg == "--io=mmap") {
+               options.io = IoMode::Mmap;
+           }
+           else if (arg.rfind("--", 0) == 0) {
+               std::cerr << "Unknown option: " << arg << std::endl;
+               printUsage(argv[0]);
+               return 1;
+           }
+           else {
+               positional.push_back(arg);
+           }
+       }
+   }
+   catch (const std::exception&) {
+       printUsage(argv[0]);
+       return 1;
+   }
+
+   if (options.partitions > 1 && options.outputFormat == OutputFormat::Columnar) {
+       // Chunks and their index span the whole output, so slices cannot be written apart
+       std::cerr << "--partitions does not apply to columnar output" << std::endl;
+       return 1;
+   }
+
+   if (convertToCsv) {
+       if (positional.size() != 2) {
+           printUsage(argv[0]);
+           return 1;
+       }
+       return convertColumnarToCsv(positional[0], positional[1]) ? 0 : 1;
+   }
+
+   if (schema == "l2-deltas") {
+       return runCommand<L2DeltaSchema>(argv[0], command, positional, options, coordinatorAddress, listenPort, workers);
+   }
+   if (schema != "ticks") {
+       std::cerr << "Unknown schema: " << schema << std::endl;
+       return 1;
+   }
+   return runCommand<TickSchema>(argv[0], command, positional, options, coordinatorAddress, listenPort, workers);
+}
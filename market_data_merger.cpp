@@ -1,162 +1,1925 @@
 // market_data_merger.cpp
 #include "market_data_merger.h"
+#include "append_state.h"
+#include "bar_writer.h"
+#include "buffer_arena.h"
+#include "buffered_sink.h"
+#include "checksum.h"
+#include "column_batch.h"
+#include "columnar_file.h"
+#include "decompressor.h"
+#include "file_reader.h"
+#include "file_watcher.h"
+#include "input_manifest.h"
+#include "kway_merger.h"
+#include "merge_checkpoint.h"
+#include "net_stream.h"
+#include "row_reducer.h"
+#include "run_file.h"
+#include "sparse_index.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
 #include <algorithm>
 
 namespace fs = std::filesystem;
 
-MarketDataMerger::MarketDataMerger(const std::string& inputDir, const std::string& tempDir, const std::string& outputFile)
-    : inputDir_(inputDir), tempDir_(tempDir), outputFile_(outputFile) {
+namespace {
+
+// Offset of a row start at or before the first row of a sorted input with a timestamp >= 'from'.
+// 'reader' starts just after the header; bisects the byte range up to 'size', reading one row per
+// probe, and leaves the last 64 KiB or less to the caller's linear scan.
+template <typename Schema>
+uint64_t findFirstRow(FileReader& reader, uint64_t size, int64_t from) {
+    const uint64_t linearBytes = 1 << 16;
+    uint64_t lo = reader.tell(); // A row start; every row before it is older than 'from'
+    uint64_t hi = size;
+    while (hi > lo && hi - lo > linearBytes) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        std::string_view line;
+        if (!reader.seek(mid) || !reader.nextLine(line)) break; // Skip the row 'mid' falls into
+        bool older = false;
+        uint64_t rowEnd = 0;
+        while (reader.tell() < hi && reader.nextLine(line)) {
+            int64_t timestamp;
+            if (parseKeyTimestamp<Schema>(line, reader.lineComma(), timestamp)) {
+                older = timestamp < from;
+                rowEnd = reader.tell();
+                break;
+            }
+        }
+        if (older) lo = rowEnd;
+        else hi = mid;
+    }
+    return lo;
 }
 
-void MarketDataMerger::merge() {
-    // Get all input files
-    std::vector<std::string> allFiles = getInputFiles();
-    if (allFiles.empty()) {
-        std::cerr << "No input files found in " << inputDir_ << std::endl;
-        return;
+// How sources are opened beyond ReadOptions
+struct SourceOptions {
+    TimeRange window;
+    bool readIndex = false;     // Inputs: seek with a valid sidecar index (see sparse_index.h)
+    uint64_t indexInterval = 0; // Inputs: bytes between the samples of a sidecar written while reading (0 = none)
+    const std::unordered_map<std::string, uint64_t>* resumeOffsets = nullptr; // Append: input -> first unmerged byte
+    const std::unordered_map<std::string, uint64_t>* endOffsets = nullptr;    // Append: input -> end of what is merged
+};
+
+SourceOptions sourceOptionsFor(const MergeOptions& options, bool writeIndex) {
+    SourceOptions source;
+    source.window = options.window;
+    source.readIndex = options.useIndex;
+    if (options.useIndex && writeIndex) source.indexInterval = std::max<uint64_t>(options.indexInterval, 1);
+    return source;
+}
+
+// Phase-1 source: a per-symbol input file; the symbol id comes from the file name
+template <typename Schema>
+struct InputFileSource {
+    FileReader reader;
+    MergeKey current{0, 0};
+    std::string_view payload; // The current row; a view into reader's buffer
+    uint64_t rowOffset = 0;   // Of the current row in the file
+    std::string path;         // Of the file, for warnings about its rows
+    TimeRange window;
+    // Index samples taken while reading the whole file, for a sidecar that was missing or stale
+    std::vector<IndexEntry> samples;
+    uint64_t sampleInterval = 0; // 0 = not sampling
+    uint64_t nextSample = 0;
+    uint64_t fileSize = 0;
+    int64_t fileMtime = 0;
+    bool sampledAll = false; // Reached end of file while sampling
+
+    const MergeKey& key() const { return current; }
+    const FileReader& file() const { return reader; }
+
+    // Opens the file past its header or, with a start bound, at the row found in its sidecar index
+    // or else by bisection on a small probe reader (a prefetching reader cannot seek), so rows
+    // before the window are not read. The sidecar and the probe are closed before the reader
+    // opens, so a source never holds more than the one descriptor its lease counts. With an end
+    // offset, rows appended past it are left for the next --append run.
+    bool open(const std::string& path, const ReadOptions& readOptions, const SourceOptions& source) {
+        this->path = path;
+        window = source.window;
+        ReadOptions options = readOptions;
+        if (source.endOffsets) {
+            auto it = source.endOffsets->find(path);
+            if (it != source.endOffsets->end()) options.endOffset = it->second;
+        }
+        if (source.resumeOffsets) {
+            // Append: the rows before this offset (header included) are already in the output
+            auto it = source.resumeOffsets->find(path);
+            if (it != source.resumeOffsets->end() && it->second > 0) {
+                ReadOptions start = options;
+                start.startOffset = it->second;
+                return reader.open(path, start);
+            }
+        }
+        SparseIndex index;
+        bool indexed = source.readIndex && index.load(path);
+        std::string_view header;
+        if (window.from == INT64_MIN) {
+            if (source.indexInterval > 0 && !indexed && SparseIndex::stat(path, fileSize, fileMtime)) {
+                sampleInterval = source.indexInterval;
+            }
+            if (!reader.open(path, options)) return false;
+            reader.nextLine(header);
+            return true;
+        }
+        ReadOptions start = options;
+        if (indexed) {
+            start.startOffset = index.seekOffset(window.from);
+            return reader.open(path, start);
+        }
+        ReadOptions probeOptions;
+        probeOptions.mode = options.mode;
+        probeOptions.bufferSize = 4096;
+        FileReader probe;
+        uint64_t size;
+        if (!Decompressor::contentSize(path, size)) {
+            // A compressed input without a seek table cannot be bisected; next() skips to the window
+            if (!reader.open(path, options)) return false;
+            reader.nextLine(header);
+            return true;
+        }
+        probeOptions.endOffset = options.endOffset;
+        if (!probe.open(path, probeOptions)) return false;
+        probe.nextLine(header);
+        start.startOffset = findFirstRow<Schema>(probe, std::min(size, options.endOffset), window.from);
+        probe.close(); // Before the reader opens
+        return reader.open(path, start);
     }
 
-    // Process in groups of MAX_FILES_OPEN
-    size_t numGroups = (allFiles.size() + MAX_FILES_OPEN - 1) / MAX_FILES_OPEN;
-    std::vector<std::string> tempFiles;
+    bool next() {
+        for (;;) {
+            uint64_t rowStart = reader.tell();
+            if (!reader.nextLine(payload)) break;
+            // Malformed lines (no comma or unparsable timestamp) are skipped, as are rows before the window
+            if (!parseKeyTimestamp<Schema>(payload, reader.lineComma(), current.timestamp)) continue;
+            if (sampleInterval > 0 && rowStart >= nextSample) {
+                samples.push_back({current.timestamp, rowStart});
+                nextSample = rowStart + sampleInterval;
+            }
+            if (current.timestamp < window.from) continue;
+            if (current.timestamp >= window.to) return false; // Sorted input: nothing further is wanted
+            rowOffset = rowStart;
+            return true;
+        }
+        sampledAll = sampleInterval > 0;
+        return false;
+    }
 
-    for (size_t i = 0; i < numGroups; ++i) {
-        size_t start = i * MAX_FILES_OPEN;
-        size_t end = std::min(start + MAX_FILES_OPEN, allFiles.size());
-        std::vector<std::string> groupFiles(allFiles.begin() + start, allFiles.begin() + end);
-        std::string tempOutput = tempDir_ + "/temp_" + std::to_string(i) + ".txt";
-        mergeGroup(groupFiles, tempOutput);
-        tempFiles.push_back(tempOutput);
+    // Writes the sidecar index sampled while reading, if the whole file was read. Failure (e.g. a
+    // read-only input directory) is not an error: the next run just bisects again. The reader is
+    // closed first, so the sidecar's descriptor is the one the lease counted for it.
+    void saveIndex(const std::string& path) {
+        if (!sampledAll || reader.failed()) return;
+        reader.close();
+        SparseIndex index;
+        index.assign(std::move(samples), fileSize, fileMtime, sampleInterval);
+        index.save(path);
+        sampledAll = false;
     }
+};
 
-    // Merge temporary files into final output
-    mergeTemporaryFiles(tempFiles, outputFile_);
+// Source for later passes: a binary run written by an earlier pass
+struct RunFileSource {
+    RunReader reader;
+    MergeKey current{0, 0};
+    std::string_view payload; // The original input row
 
-    // Clean up temporary files
-    for (const auto& tempFile : tempFiles) {
-        fs::remove(tempFile);
+    const MergeKey& key() const { return current; }
+    const FileReader& file() const { return reader.file(); }
+    bool open(const std::string& path, const ReadOptions& options, const SourceOptions&) { return reader.open(path, options); }
+    bool next() { return reader.next(current, payload); }
+};
+
+// Dedup/conflation stage of a merge: what options.dedup and options.conflateNanos drop from rows of 'Schema'
+template <typename Schema>
+ReduceOptions reduceOptionsFor(const MergeOptions& options) {
+    ReduceOptions reduce;
+    reduce.dedup = options.dedup;
+    reduce.conflateNanos = options.conflateNanos;
+    reduce.delimiter = Schema::DELIMITER;
+    reduce.groupColumn = Schema::CONFLATION_COLUMN;
+    reduce.keepGroup = Schema::CONFLATION_EXEMPT;
+    return reduce;
+}
+
+// Files opened (or examined) at the same time. Opening is mostly waiting on storage: the open
+// itself, a sidecar, a --from bisection, the first read. Overlapping those hides the latency of
+// cold or remote storage.
+const size_t OPEN_THREADS = 8;
+
+// Opens one source per path, several at a time; one that fails to open is reported and then
+// behaves as empty
+template <typename Source>
+std::vector<Source> openSources(const std::vector<std::string>& paths, const ReadOptions& options,
+                                const SourceOptions& sourceOptions, bool* allOpened = nullptr) {
+    std::vector<Source> sources(paths.size());
+    std::vector<char> opened(paths.size(), 0);
+    auto open = [&](size_t i) { opened[i] = sources[i].open(paths[i], options, sourceOptions) ? 1 : 0; };
+    if (paths.size() > 1) {
+        ThreadPool pool(std::min(OPEN_THREADS, paths.size()));
+        for (size_t i = 0; i < paths.size(); ++i) pool.submit([&open, i] { open(i); });
+        pool.wait();
+    }
+    else {
+        for (size_t i = 0; i < paths.size(); ++i) open(i);
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!opened[i]) std::cerr << "Failed to open " << paths[i] << std::endl;
     }
+    if (allOpened) *allOpened = std::find(opened.begin(), opened.end(), 0) == opened.end();
+    return sources;
 }
 
-void MarketDataMerger::mergeGroup(const std::vector<std::string>& files, const std::string& outputFile) {
-    std::priority_queue<MarketEntry, std::vector<MarketEntry>, CompareMarketEntry> minHeap;
-    std::vector<std::ifstream> fileStreams(files.size());
+// Coordinator: the merged stream of one worker, as a source of the final merge
+struct NetworkSource {
+    RunStreamReceiver receiver;
+    MergeKey current{0, 0};
+    std::string_view payload;
 
-    // Open files and populate heap with first entries
-    for (size_t i = 0; i < files.size(); ++i) {
-        fileStreams[i].open(files[i]);
-        if (!fileStreams[i].is_open()) {
-            std::cerr << "Failed to open " << files[i] << std::endl;
-            continue;
+    const MergeKey& key() const { return current; }
+    const RunStreamReceiver& file() const { return receiver; }
+    bool next() { return receiver.next(current, payload); }
+};
+
+// Bytes a source read that are not in the metrics yet: file readers count theirs as they go
+// (ReadOptions::readCounter), worker streams only when the merge is done
+uint64_t unpublishedBytes(const FileReader&) {
+    return 0;
+}
+
+uint64_t unpublishedBytes(const RunStreamReceiver& receiver) {
+    return receiver.bytesRead();
+}
+
+// Publishes what each source read ('file()' of any source kind) into 'metrics'
+// Whether a source stopped short of its data: corrupt compressed input or a read error. Worker
+// streams report theirs per worker.
+bool readFailed(const FileReader& file) {
+    return file.failed();
+}
+
+bool readFailed(const RunStreamReceiver&) {
+    return false;
+}
+
+// True if every source was read through, else reports the ones that were not
+template <typename Source>
+bool sourcesRead(const std::vector<Source>& sources, const std::vector<std::string>& paths) {
+    bool ok = true;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (readFailed(sources[i].file())) {
+            std::cerr << "Failed to read " << paths[i] << std::endl;
+            ok = false;
         }
-        std::string line;
-        if (std::getline(fileStreams[i], line)) { // Skip header
-            if (std::getline(fileStreams[i], line)) {
-                size_t pos = line.find(',');
-                if (pos != std::string::npos) {
-                    std::string timestamp = line.substr(0, pos);
-                    std::string symbol = extractSymbol(files[i]);
-                    minHeap.emplace(timestamp, symbol, line, i);
-                }
+    }
+    return ok;
+}
+
+template <typename Source>
+void addReadMetrics(const std::vector<Source>& sources, const std::vector<std::string>& paths, MergeMetrics& metrics) {
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const auto& file = sources[i].file();
+        metrics.addRead(unpublishedBytes(file), file.stallNanos());
+        metrics.addSource({paths[i], file.bytesRead(), static_cast<double>(file.stallNanos()) / 1e9});
+    }
+}
+
+// Final output: "SYMBOL,row" text lines below the header
+template <typename Schema>
+class CsvWriter {
+public:
+    CsvWriter(const SymbolTable& symbols) : symbols_(symbols) {}
+
+    bool open(const std::string& path, size_t bufferSize = BufferedSink::DEFAULT_BUFFER_SIZE) {
+        if (!out_.open(path, bufferSize)) return false;
+        out_.write("Symbol");
+        out_.put(Schema::DELIMITER);
+        out_.write(Schema::COLUMNS);
+        out_.put('\n');
+        return true;
+    }
+    bool close() { return out_.close(); }
+    void flush() { out_.flush(); }
+    const BufferedSink& sink() const { return out_; }
+
+    void write(const MergeKey& key, std::string_view payload) {
+        const std::string& symbol = symbols_.name(key.symbolId);
+        out_.write(symbol.data(), symbol.size());
+        out_.put(Schema::DELIMITER);
+        out_.write(payload.data(), payload.size());
+        out_.put('\n');
+    }
+
+private:
+    const SymbolTable& symbols_;
+    BufferedSink out_;
+};
+
+// Where the current row of a source comes from: a file and byte offset for inputs, nothing for
+// runs, worker streams and reduced merges, whose rows have lost their position
+template <typename Schema>
+std::string rowLocation(const InputFileSource<Schema>& source) {
+    return source.path + " at byte " + std::to_string(source.rowOffset);
+}
+
+template <typename Source>
+std::string rowLocation(const Source&) {
+    return std::string();
+}
+
+// Rows reported one by one before only the total is; a bad feed can have millions
+const uint64_t REPORTED_REJECTS = 10;
+
+// Typed parsing: counts a row whose fields do not fit MarketRecord (a price with more than 6
+// decimals, a non-numeric size, ...). CSV output keeps such rows, so each one is made known.
+void rejectRow(MergeMetrics& metrics, const std::string& symbol, const std::string& location, std::string_view row) {
+    if (metrics.rejected() < REPORTED_REJECTS) {
+        std::cerr << "Leaving out a row of " << symbol << (location.empty() ? "" : " (" + location + ")")
+                  << " that typed parsing cannot represent: " << row << std::endl;
+    }
+    metrics.addRejected(1);
+}
+
+// Prints the total of rejectRow() once a merge is done, if the warnings did not list them all
+void reportRejectedTotal(uint64_t rejected) {
+    if (rejected > REPORTED_REJECTS) {
+        std::cerr << rejected << " rows in total were left out because typed parsing cannot represent them" << std::endl;
+    }
+}
+
+// Typed mode: wraps a text source and parses its rows, a chunk at a time, into columns. The merge
+// then reads keys out of the timestamp column and output is gathered from the columns by row index.
+template <typename Source>
+struct ColumnSource {
+    static const size_t CHUNK_ROWS = 1024; // 32 KiB of columns per source
+
+    Source* base = nullptr;
+    FieldDictionary* exchanges = nullptr;
+    FieldDictionary* types = nullptr;
+    const SymbolTable* symbols = nullptr;
+    MergeMetrics* metrics = nullptr; // Counts the rows that do not parse
+    ColumnBatch chunk;
+    size_t row = 0; // Current row within 'chunk'
+    MergeKey current{0, 0};
+
+    void attach(Source& source, FieldDictionary& exchangeNames, FieldDictionary& typeNames,
+                const SymbolTable& symbolNames, MergeMetrics& counts) {
+        base = &source;
+        exchanges = &exchangeNames;
+        types = &typeNames;
+        symbols = &symbolNames;
+        metrics = &counts;
+        chunk.reserve(CHUNK_ROWS);
+    }
+
+    const MergeKey& key() const { return current; }
+
+    bool next() {
+        if (row + 1 < chunk.size()) {
+            ++row;
+        }
+        else {
+            if (!refill()) return false;
+            row = 0;
+        }
+        current = MergeKey{chunk.timestamps[row], chunk.symbols[row]};
+        return true;
+    }
+
+    // Parses the next chunk of rows; rows whose fields do not parse are counted and left out
+    bool refill() {
+        chunk.clear();
+        MarketRecord record;
+        while (chunk.size() < CHUNK_ROWS && base->next()) {
+            record.timestamp = base->current.timestamp;
+            record.symbolId = base->current.symbolId;
+            if (parseRecordFields(base->payload, base->payload.find(','), record, *exchanges, *types)) {
+                chunk.push(record);
             }
+            else {
+                rejectRow(*metrics, symbols->name(record.symbolId), rowLocation(*base), base->payload);
+            }
+        }
+        return !chunk.empty();
+    }
+};
+
+// Typed mode: merges column sources, gathering the winning rows into L2-sized column batches
+// that 'out' serializes a batch at a time
+template <typename Source, typename Writer>
+void mergeColumns(std::vector<ColumnSource<Source>>& sources, Writer& out, MergeKernel kernel, MergeMetrics& metrics) {
+    const size_t batchRows = ColumnBatch::cacheRows();
+    ColumnBatch batch;
+    batch.reserve(batchRows);
+    KWayMerger<MergeKey, ColumnSource<Source>> merger(sources, kernel);
+    while (!merger.empty()) {
+        const ColumnSource<Source>& source = merger.top();
+        batch.append(source.chunk, source.row);
+        merger.advance();
+        if (batch.size() == batchRows) {
+            out.write(batch);
+            metrics.addRecords(batch.size());
+            batch.clear();
+        }
+    }
+    out.write(batch);
+    metrics.addRecords(batch.size());
+    metrics.addKernel(merger.operations(), merger.comparisons());
+}
+
+// Drains 'sources' in key order into 'out', publishing the record count in batches
+template <typename Source, typename Writer>
+void mergeSources(std::vector<Source>& sources, Writer& out, MergeKernel kernel, MergeMetrics& metrics) {
+    const uint64_t publishEvery = 1 << 16;
+    uint64_t unpublished = 0;
+    KWayMerger<MergeKey, Source> merger(sources, kernel);
+    while (!merger.empty()) {
+        const Source& source = merger.top();
+        out.write(source.current, source.payload);
+        merger.advance();
+        if (++unpublished == publishEvery) {
+            metrics.addRecords(unpublished);
+            unpublished = 0;
+        }
+    }
+    metrics.addRecords(unpublished);
+    metrics.addKernel(merger.operations(), merger.comparisons());
+}
+
+// --dedup / --conflate: the k-way merge of the inputs passed through a RowReducer, as a single
+// source for the usual merge loops. A symbol's rows all come from one input, so reducing each
+// merge of inputs is exact however the inputs are grouped, and every later pass moves less data.
+template <typename Source>
+struct ReducedSource {
+    std::vector<Source> sources;
+    std::unique_ptr<KWayMerger<MergeKey, Source>> merger; // Over 'sources'
+    std::unique_ptr<RowReducer> reducer;
+    MergeMetrics* metrics = nullptr;
+    uint64_t handedOn = 0;
+    MergeKey current{0, 0};
+    std::string_view payload;
+
+    ~ReducedSource() { release(); }
+
+    void start(std::vector<Source> merged, MergeKernel kernel, const ReduceOptions& options, MergeMetrics& counts) {
+        sources = std::move(merged);
+        merger = std::make_unique<KWayMerger<MergeKey, Source>>(sources, kernel);
+        reducer = std::make_unique<RowReducer>(options);
+        metrics = &counts;
+    }
+
+    // Publishes the counts and hands the sources back. The one-source merge reading this counts an
+    // operation per row handed on, so those are taken out of the inner kernel's total.
+    std::vector<Source> release() {
+        if (merger) {
+            metrics->addKernel(merger->operations() - handedOn, merger->comparisons());
+            metrics->addDropped(reducer->dropped());
+            merger.reset();
         }
+        return std::move(sources);
     }
 
-    std::ofstream outFile(outputFile);
-    if (!outFile.is_open()) {
-        std::cerr << "Failed to open " << outputFile << std::endl;
+    const MergeKey& key() const { return current; }
+
+    bool next() {
+        while (!reducer->next(current, payload)) {
+            if (merger->empty()) return false;
+            do {
+                const Source& source = merger->top();
+                reducer->add(source.current, source.payload);
+                merger->advance();
+            } while (!merger->empty() && reducer->accepts(merger->top().current));
+        }
+        ++handedOn;
+        return true;
+    }
+};
+
+// Calls 'merge' with 'sources', or with their ReducedSource when 'options' drop rows
+template <typename Source, typename Merge>
+void mergeReduced(std::vector<Source>& sources, const ReduceOptions& options, MergeKernel kernel, MergeMetrics& metrics,
+                  Merge&& merge) {
+    if (!options.enabled()) {
+        merge(sources);
         return;
     }
+    std::vector<ReducedSource<Source>> reduced(1);
+    reduced[0].start(std::move(sources), kernel, options, metrics);
+    merge(reduced);
+    sources = reduced[0].release();
+}
+
+// The inputs of reduced sources, which are in the order of 'paths'
+template <typename Source>
+bool sourcesRead(const std::vector<ReducedSource<Source>>& reduced, const std::vector<std::string>& paths) {
+    bool ok = true;
+    for (const auto& source : reduced) ok = sourcesRead(source.sources, paths) && ok;
+    return ok;
+}
+
+// Final pass behind MarketDataMerger::stream(): the consumer pulls records out of the k-way merge,
+// parsing each row's fields as it goes. Reads the files 'paths'; if they are runs, owns them and
+// removes them when done.
+template <typename Source>
+class SourceStream : public MergeStream::Impl {
+public:
+    SourceStream(std::vector<Source> sources, std::vector<std::string> paths, bool ownsRuns, MergeKernel kernel,
+                 MergeMetrics& metrics)
+        : sources_(std::move(sources)), paths_(std::move(paths)), ownsRuns_(ownsRuns), merger_(sources_, kernel),
+          metrics_(metrics) {}
 
-    // Merge entries
-    while (!minHeap.empty()) {
-        MarketEntry entry = minHeap.top();
-        minHeap.pop();
-        outFile << entry.symbol << "," << entry.line << "\n";
+    ~SourceStream() override {
+        metrics_.addKernel(merger_.operations(), merger_.comparisons());
+        reportRejectedTotal(rejected);
+        sources_.clear(); // Close the runs before removing them
+        if (ownsRuns_) {
+            for (const auto& run : paths_) fs::remove(run);
+        }
+    }
 
-        // Declare 'line' in this scope
-        std::string line;
-        if (std::getline(fileStreams[entry.fileIndex], line)) {
-            size_t pos = line.find(',');
-            if (pos != std::string::npos) {
-                std::string timestamp = line.substr(0, pos);
-                minHeap.emplace(timestamp, entry.symbol, line, entry.fileIndex);
+    bool fill(RecordBatch& batch, size_t count) override {
+        size_t added = 0;
+        while (added < count && !merger_.empty()) {
+            const Source& source = merger_.top();
+            MarketRecord record;
+            record.timestamp = source.current.timestamp;
+            record.symbolId = source.current.symbolId;
+            if (parseRecordFields(source.payload, source.payload.find(','), record, exchanges, types)) {
+                batch.push_back(record);
+                ++added;
+            }
+            else {
+                rejectRow(metrics_, symbols->name(record.symbolId), rowLocation(source), source.payload);
+                ++rejected;
             }
+            merger_.advance();
         }
+        metrics_.addRecords(added);
+        if (merger_.empty() && !failed) failed = !sourcesRead(sources_, paths_);
+        return !merger_.empty();
     }
 
-    for (auto& fs : fileStreams) {
-        if (fs.is_open()) fs.close();
+private:
+    std::vector<Source> sources_;
+    std::vector<std::string> paths_;
+    bool ownsRuns_;
+    KWayMerger<MergeKey, Source> merger_; // Refers to sources_
+    MergeMetrics& metrics_;
+};
+
+// Set by MarketDataMerger::stopFollowing(), possibly from a signal handler
+std::atomic<bool> followStopRequested{false};
+
+// Follow mode: an input file that may still be growing. Complete rows are copied out of the
+// reader as they arrive and wait here until the merge watermark passes them.
+template <typename Schema>
+struct FollowSource {
+    struct Row {
+        int64_t timestamp;
+        size_t offset; // Of the row's text in 'text'
+        size_t length;
+    };
+
+    FileReader reader;
+    uint32_t symbolId = 0;
+    bool headerSkipped = false;
+    int64_t watermark = INT64_MIN; // Newest timestamp read so far
+    std::chrono::steady_clock::time_point lastActivity;
+    TimeRange window;
+    std::string text;       // Text of the pending rows, back to back
+    std::vector<Row> rows;  // Pending rows in file order
+    size_t head = 0;        // First row not yet emitted
+
+    // Reads whatever has been appended since the last call; true if any line arrived. Rows ordered
+    // before 'emitted' can no longer be placed correctly and are counted in 'late'.
+    bool poll(const MergeKey& emitted, uint64_t& late) {
+        bool active = false;
+        std::string_view line;
+        reader.resume();
+        while (reader.nextLine(line)) {
+            active = true;
+            if (!headerSkipped) {
+                headerSkipped = true;
+                continue;
+            }
+            int64_t timestamp;
+            if (!parseKeyTimestamp<Schema>(line, reader.lineComma(), timestamp)) continue; // Malformed: skip
+            watermark = std::max(watermark, timestamp); // Rows outside the window still advance it
+            if (!window.contains(timestamp)) continue;
+            if (MergeKey{timestamp, symbolId} < emitted) ++late;
+            rows.push_back({timestamp, text.size(), line.size()});
+            text.append(line.data(), line.size());
+        }
+        return active;
+    }
+
+    // Drops the rows before 'head' once they make up most of the buffer
+    void compact() {
+        if (head == 0 || head * 2 < rows.size()) return;
+        size_t shift = head < rows.size() ? rows[head].offset : text.size();
+        text.erase(0, shift);
+        rows.erase(rows.begin(), rows.begin() + static_cast<std::ptrdiff_t>(head));
+        for (Row& row : rows) row.offset -= shift;
+        head = 0;
+    }
+};
+
+// One emission round over a FollowSource: its pending rows [pos, end) that the watermark has passed
+template <typename Schema>
+struct FollowBatchSource {
+    FollowSource<Schema>* source = nullptr;
+    size_t pos = 0;
+    size_t end = 0;
+    MergeKey current{0, 0};
+    std::string_view payload;
+
+    const MergeKey& key() const { return current; }
+
+    bool next() {
+        if (pos == end) return false;
+        const typename FollowSource<Schema>::Row& row = source->rows[pos++];
+        current = MergeKey{row.timestamp, source->symbolId};
+        payload = std::string_view(source->text.data() + row.offset, row.length);
+        return true;
     }
+};
+
+// Adds the lifetime of the timer to 'seconds'
+class PhaseTimer {
+public:
+    explicit PhaseTimer(double& seconds) : seconds_(seconds), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() { seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count(); }
+
+private:
+    double& seconds_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// k^exponent, saturating at SIZE_MAX
+size_t saturatingPow(size_t k, size_t exponent) {
+    size_t result = 1;
+    for (size_t i = 0; i < exponent; ++i) {
+        if (result > SIZE_MAX / k) return SIZE_MAX;
+        result *= k;
+    }
+    return result;
 }
 
-void MarketDataMerger::mergeTemporaryFiles(const std::vector<std::string>& tempFiles, const std::string& finalOutput) {
-    std::priority_queue<MarketEntry, std::vector<MarketEntry>, CompareMarketEntry> minHeap;
-    std::vector<std::ifstream> fileStreams(tempFiles.size());
+// Fewest merge passes that combine 'count' sources when each merge reads at most 'maxFanIn' of them
+size_t passesFor(size_t count, size_t maxFanIn) {
+    size_t passes = 1;
+    while (saturatingPow(maxFanIn, passes) < count) ++passes;
+    return passes;
+}
 
-    // Open temp files and populate heap
-    for (size_t i = 0; i < tempFiles.size(); ++i) {
-        fileStreams[i].open(tempFiles[i]);
-        if (!fileStreams[i].is_open()) {
-            std::cerr << "Failed to open " << tempFiles[i] << std::endl;
+// Smallest fan-in that still combines 'count' sources in 'passes' passes, so that every pass
+// shrinks the source count by the same factor
+size_t balancedFanIn(size_t count, size_t passes) {
+    size_t fanIn = 2;
+    while (saturatingPow(fanIn, passes) < count) ++fanIn;
+    return fanIn;
+}
+
+// Partitioned merge: up to parts - 1 ascending timestamps inside 'window' that split the input
+// bytes into slices of about equal size, each a multiple of 'granularity' nanoseconds. File
+// positions come from current sidecar indexes, or else from a few dozen probes per file.
+template <typename Schema>
+std::vector<int64_t> partitionSplits(const std::vector<std::string>& files, const TimeRange& window, size_t parts,
+                                     int64_t granularity) {
+    const uint64_t probesPerFile = 64;
+    struct Sample {
+        int64_t timestamp;
+        uint64_t bytes; // Input represented by the sample
+    };
+    std::vector<Sample> samples;
+    for (const auto& path : files) {
+        SparseIndex index;
+        if (index.load(path)) {
+            const std::vector<IndexEntry>& entries = index.entries();
+            // The index records a compressed input's file size, not its content size
+            uint64_t fileEnd = index.fileSize();
+            if (!entries.empty() && compressionOf(path) != Compression::None) fileEnd = entries.back().offset + index.interval();
+            for (size_t i = 0; i < entries.size(); ++i) {
+                uint64_t end = i + 1 < entries.size() ? entries[i + 1].offset : fileEnd;
+                samples.push_back({entries[i].timestamp, end - entries[i].offset});
+            }
             continue;
         }
-        std::string line;
-        if (std::getline(fileStreams[i], line)) {
-            size_t firstComma = line.find(',');
-            size_t secondComma = line.find(',', firstComma + 1);
-            if (firstComma != std::string::npos && secondComma != std::string::npos) {
-                std::string symbol = line.substr(0, firstComma);
-                std::string timestamp = line.substr(firstComma + 1, secondComma - firstComma - 1);
-                minHeap.emplace(timestamp, symbol, line, i);
+        ReadOptions probeOptions;
+        probeOptions.bufferSize = 4096;
+        FileReader probe;
+        uint64_t size;
+        if (!Decompressor::contentSize(path, size) || !probe.open(path, probeOptions)) continue; // Too slow to probe
+        std::string_view line;
+        for (uint64_t k = 0; k < probesPerFile; ++k) {
+            // Skip the row the probe lands in (the header for the first probe) and take the next one
+            if (!probe.seek(size / probesPerFile * k) || !probe.nextLine(line)) break;
+            int64_t timestamp;
+            bool found = false;
+            while (!found && probe.nextLine(line)) found = parseKeyTimestamp<Schema>(line, probe.lineComma(), timestamp);
+            if (found) samples.push_back({timestamp, size / probesPerFile});
+        }
+    }
+
+    samples.erase(std::remove_if(samples.begin(), samples.end(),
+                                 [&window](const Sample& sample) { return !window.contains(sample.timestamp); }),
+                  samples.end());
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.timestamp < b.timestamp; });
+    double total = 0;
+    for (const Sample& sample : samples) total += static_cast<double>(sample.bytes);
+
+    std::vector<int64_t> splits;
+    double covered = 0;
+    size_t nextSplit = 1;
+    for (const Sample& sample : samples) {
+        if (nextSplit == parts) break;
+        if (covered >= total * static_cast<double>(nextSplit) / static_cast<double>(parts)) {
+            // Equal timestamps (and conflation buckets) stay in one slice, so a split only ever moves forward
+            int64_t split = timeBucket(sample.timestamp, granularity) * granularity;
+            if (split > window.from && (splits.empty() || split > splits.back())) splits.push_back(split);
+            ++nextSplit;
+        }
+        covered += static_cast<double>(sample.bytes);
+    }
+    return splits;
+}
+
+// Timestamp of the first data row at or after 'offset' (a row start, or 0 for the header) of an input
+template <typename Schema>
+bool firstRowTimestamp(const std::string& path, uint64_t offset, int64_t& timestamp) {
+    ReadOptions probeOptions;
+    probeOptions.bufferSize = 4096;
+    probeOptions.startOffset = offset;
+    FileReader probe;
+    if (!probe.open(path, probeOptions)) return false;
+    std::string_view line;
+    if (offset == 0) probe.nextLine(line);
+    while (probe.nextLine(line)) {
+        if (parseKeyTimestamp<Schema>(line, probe.lineComma(), timestamp)) return true;
+    }
+    return false;
+}
+
+// Appends 'segment' to 'out', leaving out its header line
+bool appendSegment(const std::string& segment, std::FILE* out) {
+    std::FILE* in = std::fopen(segment.c_str(), "rb");
+    if (!in) return false;
+    std::vector<char> buffer(1 << 20);
+    bool header = true;
+    bool ok = true;
+    size_t bytes;
+    while (ok && (bytes = std::fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+        const char* data = buffer.data();
+        if (header) {
+            const char* newline = static_cast<const char*>(std::memchr(data, '\n', bytes));
+            if (!newline) continue;
+            header = false;
+            bytes -= static_cast<size_t>(newline + 1 - data);
+            data = newline + 1;
+        }
+        ok = std::fwrite(data, 1, bytes, out) == bytes;
+    }
+    ok = ok && !std::ferror(in);
+    std::fclose(in);
+    return ok;
+}
+
+} // namespace
+
+template <typename Schema>
+BasicMarketDataMerger<Schema>::BasicMarketDataMerger(const std::string& inputDir, const std::string& tempDir,
+                                                     const std::string& outputFile, const MergeOptions& options)
+    : inputDir_(inputDir), tempDir_(tempDir), outputFile_(outputFile), options_(options), metrics_(ownMetrics_) {
+    if (options_.threads == 0) options_.threads = 1;
+    if (!Schema::TICK_FIELDS && (options_.typed || options_.outputFormat != OutputFormat::Csv)) {
+        std::cerr << "Typed parsing, columnar and bar output need rows of the tick schema; writing CSV" << std::endl;
+        options_.typed = false;
+        options_.outputFormat = OutputFormat::Csv;
+    }
+    if (options_.partitions > 1 && options_.outputFormat == OutputFormat::Columnar) {
+        std::cerr << "Partitions do not apply to columnar output; merging unpartitioned" << std::endl;
+        options_.partitions = 1;
+    }
+    if (Schema::CONFLATION_COLUMN == NO_COLUMN && options_.conflateNanos > 0) {
+        std::cerr << "Rows of this schema cannot be conflated; not conflating" << std::endl;
+        options_.conflateNanos = 0;
+    }
+    if (options_.follow && (options_.dedup || options_.conflateNanos > 0)) {
+        std::cerr << "Follow mode writes every row; ignoring --dedup and --conflate" << std::endl;
+        options_.dedup = false;
+        options_.conflateNanos = 0;
+    }
+}
+
+template <typename Schema>
+BasicMarketDataMerger<Schema>::BasicMarketDataMerger(BasicMarketDataMerger& parent, const TimeRange& slice, size_t index,
+                                                     size_t parts)
+    : inputDir_(parent.inputDir_), tempDir_(parent.tempDir_), options_(parent.options_), symbols_(parent.symbols_),
+      metrics_(parent.metrics_) {
+    // The first slice writes the start of the output in place; the others go to segments appended to it
+    outputFile_ = index == 0 ? parent.outputFile_ : tempDir_ + "/segment_" + std::to_string(index) + ".csv";
+    options_.window = slice;
+    options_.partitions = 1;
+    options_.threads = std::max<size_t>(options_.threads / parts, 1);
+    options_.memoryBudget /= parts;
+    filesOpenLimit_ = std::max<size_t>(parent.filesOpenLimit_ / parts, 2);
+    runPrefix_ = parent.runPrefix_ + "p" + std::to_string(index) + "_";
+    endOffsets_ = parent.endOffsets_;
+}
+
+template <typename Schema>
+BasicMarketDataMerger<Schema>::~BasicMarketDataMerger() = default;
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::merge() {
+    stats_ = MergeStats();
+    metrics_.reset();
+    auto mergeStart = std::chrono::steady_clock::now();
+    std::unique_ptr<ProgressReporter> progress;
+    if (options_.progressSeconds > 0) progress = std::make_unique<ProgressReporter>(metrics_, options_.progressSeconds);
+
+    std::vector<std::string> allFiles = loadInputs();
+    if (allFiles.empty()) return false;
+
+    bool ok;
+    if (options_.follow) {
+        ++stats_.passes;
+        PhaseTimer timer(stats_.finalMergeSeconds);
+        ok = follow(allFiles);
+    }
+    else if (options_.append) {
+        ok = mergeAppending(allFiles);
+    }
+    else {
+        ok = mergeAll(allFiles);
+    }
+    progress.reset();
+
+    metrics_.fill(stats_);
+    reportRejectedTotal(stats_.recordsRejected);
+    stats_.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart).count();
+    if (!options_.metricsFile.empty()) {
+        if (!metrics_.writeJson(options_.metricsFile, stats_)) {
+            std::cerr << "Failed to write " << options_.metricsFile << std::endl;
+        }
+    }
+    return ok;
+}
+
+template <typename Schema>
+MergeStream BasicMarketDataMerger<Schema>::stream(size_t batchSize) {
+    stats_ = MergeStats();
+    metrics_.reset();
+    std::vector<std::string> sources = loadInputs();
+    setUpReading(sources.size());
+
+    // Group passes run to completion up front; only the final pass is driven by the consumer
+    DescriptorBudget budget(filesOpenLimit_);
+    bool sourcesAreRuns = false;
+    std::unique_ptr<MergeStream::Impl> impl;
+    if (!reduceSources(sources, sourcesAreRuns, budget)) return MergeStream(std::move(impl), batchSize, true);
+    bool opened = false;
+    if constexpr (!Schema::TICK_FIELDS) {
+        std::cerr << "stream() needs rows of the tick schema" << std::endl;
+        if (sourcesAreRuns) removeTemporaryFiles(sources);
+        return MergeStream(std::move(impl), batchSize, true);
+    }
+    else if (sourcesAreRuns) {
+        std::vector<RunFileSource> runs =
+            openSources<RunFileSource>(sources, readOptions_, sourceOptionsFor(options_, false), &opened);
+        impl = std::make_unique<SourceStream<RunFileSource>>(std::move(runs), std::move(sources), true, options_.kernel,
+                                                             metrics_);
+    }
+    else {
+        std::vector<InputFileSource<Schema>> inputs =
+            openSources<InputFileSource<Schema>>(sources, readOptions_, sourceOptionsFor(options_, false), &opened);
+        for (size_t i = 0; i < inputs.size(); ++i) inputs[i].current.symbolId = symbols_.id(extractSymbol(sources[i]));
+        ReduceOptions reduce = reduceOptionsFor<Schema>(options_);
+        if (reduce.enabled()) {
+            std::vector<ReducedSource<InputFileSource<Schema>>> reduced(1);
+            reduced[0].start(std::move(inputs), options_.kernel, reduce, metrics_);
+            impl = std::make_unique<SourceStream<ReducedSource<InputFileSource<Schema>>>>(
+                std::move(reduced), std::move(sources), false, options_.kernel, metrics_);
+        }
+        else {
+            impl = std::make_unique<SourceStream<InputFileSource<Schema>>>(std::move(inputs), std::move(sources), false,
+                                                                           options_.kernel, metrics_);
+        }
+    }
+    if (!opened) return MergeStream(std::move(impl), batchSize, true); // Dropping it removes the runs
+    ++stats_.passes;
+    impl->symbols = &symbols_;
+    return MergeStream(std::move(impl), batchSize);
+}
+
+template <typename Schema>
+std::vector<std::string> BasicMarketDataMerger<Schema>::loadInputs() {
+    std::vector<std::string> files = getInputFiles();
+    if (files.empty()) {
+        std::cerr << "No input files found in " << inputDir_ << std::endl;
+    }
+
+    std::vector<std::string> symbols;
+    symbols.reserve(files.size());
+    for (const auto& file : files) {
+        symbols.emplace_back(extractSymbol(file));
+    }
+    symbols_ = SymbolTable(std::move(symbols));
+    return files;
+}
+
+template <typename Schema>
+void BasicMarketDataMerger<Schema>::setUpReading(size_t sources) {
+    // With prefetching, I/O threads keep a few blocks of every open source in memory so the merge
+    // only stalls when a whole ring has been drained
+    readOptions_ = ReadOptions();
+    readOptions_.mode = options_.io;
+    readOptions_.readCounter = metrics_.readCounter();
+    sinkBufferSize_ = BufferedSink::DEFAULT_BUFFER_SIZE;
+    prefetchPool_.reset();
+    arena_.reset();
+    bool prefetch = options_.prefetchThreads > 0 && options_.io == IoMode::Stream;
+    if (prefetch) {
+        prefetchPool_ = std::make_unique<ThreadPool>(options_.prefetchThreads);
+        readOptions_.prefetchPool = prefetchPool_.get();
+        readOptions_.prefetchDepth = options_.prefetchDepth;
+    }
+
+    // The descriptor budget caps how many sources are open at once, so that many read buffers
+    // serve the whole merge
+    size_t readers = std::max<size_t>(std::min(sources, filesOpenLimit_), 1);
+    if (options_.memoryBudget > 0) {
+        // A quarter for the output writers (two buffers each), the rest for the open sources
+        size_t writers = std::min(options_.threads, readers);
+        size_t maxSinkBuffer = BufferedSink::DEFAULT_BUFFER_SIZE;
+        sinkBufferSize_ = std::clamp<size_t>(options_.memoryBudget / 4 / (2 * writers), MIN_SINK_BUFFER, maxSinkBuffer);
+        if (options_.io == IoMode::Stream) {
+            size_t blocksPerReader = 1 + (prefetch ? options_.prefetchDepth : 0);
+            readOptions_.bufferSize = std::clamp<size_t>(options_.memoryBudget / 4 * 3 / (readers * blocksPerReader),
+                                                         MIN_READ_BUFFER, MAX_READ_BUFFER);
+        }
+    }
+    if (options_.io == IoMode::Stream) {
+        arena_ = std::make_unique<BufferArena>(readers, readOptions_.bufferSize);
+        readOptions_.arena = arena_.get();
+    }
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::reduceSources(std::vector<std::string>& sources, bool& sourcesAreRuns,
+                                                  DescriptorBudget& budget) {
+    // Each pass merges groups of at most MAX_FILES_OPEN sources. The fan-in is chosen so the number
+    // of passes (and so the I/O volume) is as low as possible, every pass writing binary temp runs.
+    size_t level = checkpoint_ && options_.resume ? skipCompletedPasses(sources) : 0;
+    sourcesAreRuns = level > 0;
+    for (;; ++level) {
+        size_t passes = passesFor(sources.size(), filesOpenLimit_);
+        if (passes == 1) return true;
+        ++stats_.passes;
+        std::vector<std::string> runs;
+        bool ok;
+        {
+            PhaseTimer timer(stats_.groupMergeSeconds);
+            ok = mergeLevel(sources, sourcesAreRuns, level, passes, budget, runs);
+        }
+        if (!ok) {
+            // The next pass would merge a truncated set of runs
+            std::cerr << "Pass " << level + 1 << " failed" << std::endl;
+            if (checkpoint_) {
+                std::cerr << "Keeping the temp runs; --resume redoes only the failed groups" << std::endl;
             }
+            else {
+                PhaseTimer cleanup(stats_.cleanupSeconds);
+                removeTemporaryFiles(runs);
+                if (sourcesAreRuns) removeTemporaryFiles(sources);
+            }
+            sourcesAreRuns = false;
+            return false;
+        }
+        if (sourcesAreRuns) {
+            PhaseTimer cleanup(stats_.cleanupSeconds);
+            removeTemporaryFiles(sources);
         }
+        sources = std::move(runs);
+        sourcesAreRuns = true;
     }
+}
 
-    std::ofstream outFile(finalOutput);
-    if (!outFile.is_open()) {
-        std::cerr << "Failed to open " << finalOutput << std::endl;
-        return;
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergeAll(const std::vector<std::string>& files) {
+    if (options_.partitions > 1) return mergePartitioned(files);
+    return mergePasses(files, outputFile_);
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergeAppending(const std::vector<std::string>& files) {
+    // Input sizes are taken before reading, up to the end of the last complete row; every source
+    // stops there, so rows a feed appends during the merge (or is still writing) go to the next run
+    AppendState previous;
+    bool havePrevious = previous.load(outputFile_);
+    AppendState state = previous;
+    state.window = options_.window;
+    state.typed = options_.typed;
+    state.dedup = options_.dedup;
+    state.conflateNanos = options_.conflateNanos;
+    state.symbols = options_.symbols;
+    std::sort(state.symbols.begin(), state.symbols.end());
+    state.symbols.erase(std::unique(state.symbols.begin(), state.symbols.end()), state.symbols.end());
+    state.columns = Schema::COLUMNS;
+    std::vector<std::pair<std::string, uint64_t>> sizes;
+    std::unordered_map<std::string, uint64_t> ends;
+    for (const auto& file : files) {
+        uint64_t size;
+        int64_t mtime;
+        if (!SparseIndex::stat(file, size, mtime)) continue;
+        // A compressed input's file size is no content offset; archives are complete anyway
+        if (compressionOf(file) == Compression::None) ends[file] = size = completeLinesEnd(file, size);
+        sizes.emplace_back(file, size);
+    }
+
+    endOffsets_ = &ends;
+    bool merged = appendNewRows(previous, state, havePrevious, sizes);
+    if (!merged) {
+        merged = mergeAll(files);
+        state.inputs.clear(); // The output now holds exactly the inputs merged this time
+    }
+    endOffsets_ = nullptr;
+    if (!merged) return false; // No state is saved, so the next run merges everything
+    for (const auto& input : sizes) state.setMergedBytes(std::string(extractSymbol(input.first)), input.second);
+    if (!state.save(outputFile_)) std::cerr << "Failed to write " << AppendState::pathFor(outputFile_) << std::endl;
+    return true;
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::appendNewRows(const AppendState& previous, const AppendState& current,
+                                                  bool havePrevious,
+                                                  const std::vector<std::pair<std::string, uint64_t>>& sizes) {
+    auto fullMerge = [](const char* reason) {
+        std::cout << "Append: " << reason << "; merging everything." << std::endl;
+        return false;
+    };
+    if (!havePrevious) return fullMerge("no current state recorded for this output");
+    if (options_.outputFormat != OutputFormat::Csv) return fullMerge("only CSV output can be appended to");
+    if (previous.window.from != options_.window.from || previous.window.to != options_.window.to ||
+        previous.typed != options_.typed || previous.dedup != options_.dedup ||
+        previous.conflateNanos != options_.conflateNanos) {
+        return fullMerge("the output was merged with other --from/--to/--typed/--dedup/--conflate settings");
+    }
+    // Inputs outside the old filter hold rows the output lacks; rows outside the new one must go
+    if (previous.symbols != current.symbols) return fullMerge("the output was merged with another --symbols filter");
+    if (previous.columns != current.columns) return fullMerge("the output was merged with another schema");
+    // The last row is "SYMBOL" DELIMITER <input row>
+    std::string lastRow;
+    std::string lastSymbol;
+    int64_t lastTimestamp = INT64_MIN;
+    bool hasRows = false;
+    if (readLastRow(outputFile_, lastRow)) {
+        size_t delimiter = lastRow.find(Schema::DELIMITER);
+        std::string_view row(lastRow);
+        row.remove_prefix(delimiter == std::string::npos ? row.size() : delimiter + 1);
+        hasRows = delimiter != std::string::npos && parseKeyTimestamp<Schema>(row, row.find(','), lastTimestamp);
+        if (hasRows) lastSymbol = lastRow.substr(0, delimiter);
+    }
+
+    int64_t reduceBucket = options_.conflateNanos > 0 ? options_.conflateNanos : options_.dedup ? 1 : 0;
+
+    // Only inputs that grew take part; each resumes at its first unmerged row, which must not sort
+    // before the output's last row (rows of the same symbol and timestamp keep file order)
+    std::unordered_map<std::string, uint64_t> offsets;
+    std::vector<std::string> grown;
+    for (const auto& input : sizes) {
+        std::string_view symbol = extractSymbol(input.first);
+        uint64_t merged = previous.mergedBytes(symbol);
+        if (input.second < merged) return fullMerge("an input got shorter");
+        if (input.second == merged) continue;
+        // Sizes of compressed inputs are file sizes, which say nothing about where new rows start
+        if (compressionOf(input.first) != Compression::None) return fullMerge("a compressed input changed");
+        int64_t timestamp;
+        if (!firstRowTimestamp<Schema>(input.first, merged, timestamp)) continue; // Nothing but malformed lines
+        if (hasRows && (timestamp < lastTimestamp || (timestamp == lastTimestamp && symbol < lastSymbol))) {
+            return fullMerge("new rows are older than the end of the output");
+        }
+        // A dedup or conflation bucket is reduced as a whole, so it must not span the two runs
+        if (hasRows && reduceBucket > 0 &&
+            timeBucket(timestamp, reduceBucket) == timeBucket(lastTimestamp, reduceBucket)) {
+            return fullMerge("new rows share a dedup/conflation bucket with the end of the output");
+        }
+        offsets[input.first] = merged;
+        grown.push_back(input.first);
+    }
+    if (grown.empty()) return true;
+
+    std::string segment = tempDir_ + "/append.csv";
+    resumeOffsets_ = &offsets;
+    bool merged = mergePasses(grown, segment);
+    resumeOffsets_ = nullptr;
+    if (!merged) {
+        fs::remove(segment);
+        std::cerr << "Failed to merge the new rows" << std::endl;
+        return false;
+    }
+
+    std::FILE* out = std::fopen(outputFile_.c_str(), "ab");
+    bool ok = out && appendSegment(segment, out);
+    if (out && std::fclose(out) != 0) ok = false;
+    fs::remove(segment);
+    if (!ok) {
+        // The output may now end in a partial append; only a full merge restores it
+        std::cerr << "Failed to append to " << outputFile_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergePasses(std::vector<std::string> sources, const std::string& outputFile) {
+    setUpReading(sources.size());
+    // Every completed temp run is checkpointed, so that a --resume merge can pick up after a crash
+    MergeCheckpoint checkpoint;
+    if (passesFor(sources.size(), filesOpenLimit_) > 1) {
+        if (checkpoint.start(MergeCheckpoint::pathFor(tempDir_, runPrefix_), jobDigest(sources), options_.resume)) {
+            checkpoint_ = &checkpoint;
+            if (options_.resume && checkpoint.resumable() == 0) {
+                std::cout << "Resume: no temp runs checkpointed for these inputs and settings; merging everything."
+                          << std::endl;
+            }
+        }
+        else {
+            std::cerr << "Failed to write " << MergeCheckpoint::pathFor(tempDir_, runPrefix_)
+                      << "; this merge cannot be resumed" << std::endl;
+        }
+    }
+    // Inputs that fit in one group are merged straight into the output
+    DescriptorBudget budget(filesOpenLimit_);
+    bool sourcesAreRuns = false;
+    bool ok = reduceSources(sources, sourcesAreRuns, budget);
+    if (ok) {
+        ++stats_.passes;
+        PhaseTimer timer(stats_.finalMergeSeconds);
+        if (sourcesAreRuns) ok = mergeTemporaryFiles(sources, outputFile, budget, true);
+        else ok = mergeGroup(sources, outputFile, budget, true);
+    }
+    if (sourcesAreRuns && !ok && checkpoint_) {
+        std::cerr << "Keeping the temp runs; --resume redoes only the final pass" << std::endl;
+    }
+    else if (sourcesAreRuns) {
+        PhaseTimer cleanup(stats_.cleanupSeconds);
+        removeTemporaryFiles(sources);
+    }
+    if (checkpoint_ && ok) checkpoint.remove();
+    checkpoint_ = nullptr;
+    readOptions_ = ReadOptions();
+    prefetchPool_.reset();
+    arena_.reset(); // Every read buffer of the merge goes back in one step
+    return ok;
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergePartitioned(const std::vector<std::string>& files) {
+    // Slices hold whole conflation buckets and bars
+    int64_t granularity = std::max<int64_t>(options_.conflateNanos, 1);
+    if (options_.outputFormat == OutputFormat::Bars) granularity = std::lcm(granularity, options_.barNanos);
+    std::vector<int64_t> bounds = partitionSplits<Schema>(files, options_.window, options_.partitions, granularity);
+    if (bounds.empty()) {
+        return mergePasses(files, outputFile_); // Too little data (or too few distinct timestamps) to split
+    }
+    bounds.insert(bounds.begin(), options_.window.from);
+    bounds.push_back(options_.window.to);
+    size_t parts = bounds.size() - 1;
+
+    // Output is ordered by timestamp first, so slices share no rows and need no merge between them
+    std::vector<std::unique_ptr<BasicMarketDataMerger>> slices;
+    for (size_t i = 0; i < parts; ++i) {
+        slices.emplace_back(new BasicMarketDataMerger(*this, TimeRange{bounds[i], bounds[i + 1]}, i, parts));
+    }
+    std::unique_ptr<bool[]> merged(new bool[parts]());
+    {
+        ThreadPool pool(parts);
+        for (size_t i = 0; i < parts; ++i) {
+            pool.submit([&slice = slices[i], &files, &done = merged[i]] { done = slice->mergePasses(files, slice->outputFile_); });
+        }
+        pool.wait();
+    }
+    // Slices run at the same time, so the slowest one sets each phase
+    for (const auto& slice : slices) {
+        const MergeStats& part = slice->stats_;
+        stats_.passes = std::max(stats_.passes, part.passes);
+        stats_.groupMergeSeconds = std::max(stats_.groupMergeSeconds, part.groupMergeSeconds);
+        stats_.finalMergeSeconds = std::max(stats_.finalMergeSeconds, part.finalMergeSeconds);
+        stats_.cleanupSeconds = std::max(stats_.cleanupSeconds, part.cleanupSeconds);
+    }
+
+    PhaseTimer timer(stats_.finalMergeSeconds);
+    bool ok = true;
+    for (size_t i = 0; i < parts; ++i) {
+        if (!merged[i]) {
+            std::cerr << "Failed to merge time slice " << i + 1 << " of " << parts << std::endl;
+            ok = false;
+        }
+    }
+    std::FILE* out = ok ? std::fopen(outputFile_.c_str(), "ab") : nullptr;
+    if (ok && !out) {
+        std::cerr << "Failed to open " << outputFile_ << std::endl;
+        ok = false;
+    }
+    for (size_t i = 1; i < parts; ++i) {
+        const std::string& segment = slices[i]->outputFile_;
+        if (ok && !appendSegment(segment, out)) {
+            std::cerr << "Failed to append " << segment << std::endl;
+            ok = false;
+        }
+        fs::remove(segment);
+    }
+    if (out && std::fclose(out) != 0 && ok) {
+        std::cerr << "Failed to write " << outputFile_ << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergeLevel(const std::vector<std::string>& sources, bool sourcesAreRuns,
+                                               size_t level, size_t passes, DescriptorBudget& budget,
+                                               std::vector<std::string>& runs) {
+    size_t fanIn = groupFanIn(sources.size(), passes);
+    size_t numGroups = (sources.size() + fanIn - 1) / fanIn;
+    runs.assign(numGroups, std::string());
+    std::atomic<size_t> reused{0};
+    std::atomic<bool> failed{false};
+    {
+        ThreadPool pool(std::min(options_.threads, numGroups));
+        for (size_t i = 0; i < numGroups; ++i) {
+            size_t start = i * fanIn;
+            size_t end = std::min(start + fanIn, sources.size());
+            std::string name = runName(level, i);
+            runs[i] = tempDir_ + "/" + name;
+            pool.submit([this, &sources, start, end, name, &output = runs[i], sourcesAreRuns, &budget, &reused, &failed] {
+                uint64_t digest = 0;
+                bool tracked = checkpoint_ && groupDigest(sources, start, end, sourcesAreRuns, digest);
+                if (tracked && options_.resume && checkpoint_->verify(name, digest, output)) {
+                    ++reused;
+                    return;
+                }
+                // A run only takes its name once complete, so a crash never leaves a partial run behind it
+                std::string partial = output + ".partial";
+                std::vector<std::string> group(sources.begin() + start, sources.begin() + end);
+                uint64_t checksum = 0;
+                bool ok = sourcesAreRuns ? mergeTemporaryFiles(group, partial, budget, false, &checksum)
+                                         : mergeGroup(group, partial, budget, false, &checksum);
+                std::error_code error;
+                if (!ok) {
+                    fs::remove(partial, error);
+                    failed = true;
+                    return;
+                }
+                fs::rename(partial, output, error);
+                if (error) {
+                    std::cerr << "Failed to rename " << partial << " to " << output << std::endl;
+                    fs::remove(partial, error);
+                    failed = true;
+                    return;
+                }
+                uint64_t size = fs::file_size(output, error);
+                if (tracked && !error && !checkpoint_->record(name, CheckpointRun{digest, size, checksum})) {
+                    std::cerr << "Failed to checkpoint " << output << std::endl;
+                }
+            });
+        }
+        pool.wait(); // The whole level must be complete before the next one starts
+    }
+    if (reused > 0) {
+        std::cout << "Resume: reused " << reused << " of " << numGroups << " temp runs of pass " << level + 1 << "."
+                  << std::endl;
+    }
+    return !failed;
+}
+
+template <typename Schema>
+size_t BasicMarketDataMerger<Schema>::skipCompletedPasses(std::vector<std::string>& sources) {
+    // Follow the recorded runs pass by pass as far as the checkpoint goes. The runs of a pass are
+    // deleted once the next pass is complete, so only the deepest complete pass is still on disk.
+    struct Pass {
+        std::vector<std::string> runs;
+        std::vector<uint64_t> digests;
+    };
+    std::vector<Pass> recorded;
+    const std::vector<std::string>* current = &sources;
+    for (size_t level = 0;; ++level) {
+        size_t passes = passesFor(current->size(), filesOpenLimit_);
+        if (passes == 1) break;
+        size_t fanIn = groupFanIn(current->size(), passes);
+        Pass pass;
+        bool complete = true;
+        for (size_t start = 0; complete && start < current->size(); start += fanIn) {
+            std::string name = runName(level, pass.runs.size());
+            uint64_t digest = 0;
+            CheckpointRun run;
+            complete = groupDigest(*current, start, std::min(start + fanIn, current->size()), level > 0, digest) &&
+                       checkpoint_->find(name, run) && run.inputs == digest;
+            pass.runs.push_back(tempDir_ + "/" + name);
+            pass.digests.push_back(digest);
+        }
+        if (!complete) break;
+        recorded.push_back(std::move(pass));
+        current = &recorded.back().runs;
+    }
+
+    for (size_t level = recorded.size(); level-- > 0;) {
+        const Pass& pass = recorded[level];
+        std::atomic<size_t> intact{0};
+        {
+            ThreadPool pool(std::min(options_.threads, pass.runs.size()));
+            for (size_t i = 0; i < pass.runs.size(); ++i) {
+                pool.submit([this, &pass, &intact, level, i] {
+                    if (checkpoint_->verify(runName(level, i), pass.digests[i], pass.runs[i])) ++intact;
+                });
+            }
+            pool.wait();
+        }
+        if (intact < pass.runs.size()) continue;
+        // The merge may have stopped between completing this pass and deleting the one before
+        if (level > 0) removeTemporaryFiles(recorded[level - 1].runs);
+        std::cout << "Resume: reusing the " << pass.runs.size() << " temp runs of pass " << level + 1 << "."
+                  << std::endl;
+        stats_.passes += level + 1;
+        sources = pass.runs;
+        return level + 1;
+    }
+    return 0;
+}
+
+template <typename Schema>
+uint64_t BasicMarketDataMerger<Schema>::jobDigest(const std::vector<std::string>& sources) const {
+    StreamChecksum digest;
+    auto add = [&digest](uint64_t value) { digest.update(&value, sizeof(value)); };
+    auto addText = [&](std::string_view text) {
+        add(text.size());
+        digest.update(text.data(), text.size());
+    };
+    addText(Schema::COLUMNS);
+    add(static_cast<uint64_t>(options_.window.from));
+    add(static_cast<uint64_t>(options_.window.to));
+    add(options_.dedup);
+    add(static_cast<uint64_t>(options_.conflateNanos));
+    // Runs refer to symbols by id
+    for (uint32_t id = 0; id < symbols_.size(); ++id) addText(symbols_.name(id));
+    for (const auto& source : sources) {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        SparseIndex::stat(source, size, mtime);
+        addText(source);
+        add(size);
+        add(static_cast<uint64_t>(mtime));
+        if (resumeOffsets_) {
+            auto it = resumeOffsets_->find(source);
+            add(it == resumeOffsets_->end() ? 0 : it->second);
+        }
+        if (endOffsets_) {
+            auto it = endOffsets_->find(source);
+            add(it == endOffsets_->end() ? UINT64_MAX : it->second);
+        }
+    }
+    return digest.value();
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::groupDigest(const std::vector<std::string>& sources, size_t start, size_t end,
+                                                bool sourcesAreRuns, uint64_t& digest) const {
+    StreamChecksum sum;
+    for (size_t i = start; i < end; ++i) {
+        std::string name = fs::path(sources[i]).filename().string();
+        sum.update(name.data(), name.size() + 1); // With its terminator, so names cannot run together
+        if (sourcesAreRuns) {
+            CheckpointRun run;
+            if (!checkpoint_->find(name, run)) return false;
+            sum.update(&run.checksum, sizeof(run.checksum));
+        }
+    }
+    digest = sum.value();
+    return true;
+}
+
+template <typename Schema>
+size_t BasicMarketDataMerger<Schema>::groupFanIn(size_t sources, size_t passes) const {
+    // The width comes from the pass plan alone, never above filesOpenLimit_, so every merge of
+    // the plan (the final one included) fits the limit. How many groups run at once is left to
+    // the descriptor budget the workers share, not to the thread count.
+    return std::max<size_t>(balancedFanIn(sources, passes), 2);
+}
+
+template <typename Schema>
+std::string BasicMarketDataMerger<Schema>::runName(size_t level, size_t group) const {
+    return runPrefix_ + std::to_string(level) + "_" + std::to_string(group) + ".run";
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergeGroup(const std::vector<std::string>& files, const std::string& outputFile,
+                                               DescriptorBudget& budget, bool finalOutput, uint64_t* runChecksum) {
+    DescriptorLease lease(budget, files.size());
+    // Inputs read from start to end leave a sidecar index behind for later windowed runs
+    SourceOptions sourceOptions = sourceOptionsFor(options_, true);
+    sourceOptions.resumeOffsets = resumeOffsets_;
+    sourceOptions.endOffsets = endOffsets_;
+    bool opened;
+    std::vector<InputFileSource<Schema>> sources =
+        openSources<InputFileSource<Schema>>(files, readOptions_, sourceOptions, &opened);
+    for (size_t i = 0; i < files.size(); ++i) {
+        sources[i].current.symbolId = symbols_.id(extractSymbol(files[i]));
+    }
+    bool written = writeMerged(sources, files, outputFile, finalOutput, runChecksum);
+    for (size_t i = 0; i < files.size(); ++i) sources[i].saveIndex(files[i]);
+    return opened && written;
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergeTemporaryFiles(const std::vector<std::string>& tempFiles,
+                                                        const std::string& outputFile, DescriptorBudget& budget,
+                                                        bool finalOutput, uint64_t* runChecksum) {
+    DescriptorLease lease(budget, tempFiles.size());
+    bool opened;
+    std::vector<RunFileSource> sources =
+        openSources<RunFileSource>(tempFiles, readOptions_, sourceOptionsFor(options_, false), &opened);
+    bool written = writeMerged(sources, tempFiles, outputFile, finalOutput, runChecksum);
+    return opened && written;
+}
+
+template <typename Schema>
+template <typename Source>
+bool BasicMarketDataMerger<Schema>::writeMerged(std::vector<Source>& sources, const std::vector<std::string>& paths,
+                                                const std::string& outputFile, bool finalOutput, uint64_t* runChecksum) {
+    bool ok = false;
+    // Runs (and worker streams) were reduced when their inputs were merged
+    if constexpr (std::is_same_v<Source, InputFileSource<Schema>>) {
+        mergeReduced(sources, reduceOptionsFor<Schema>(options_), options_.kernel, metrics_,
+                     [&](auto& merged) { ok = writeRows(merged, outputFile, finalOutput, runChecksum); });
+    }
+    else {
+        ok = writeRows(sources, outputFile, finalOutput, runChecksum);
+    }
+    if (!sourcesRead(sources, paths)) ok = false; // The output lacks the rest of those sources
+    addReadMetrics(sources, paths, metrics_);
+    return ok;
+}
+
+template <typename Schema>
+template <typename Source>
+bool BasicMarketDataMerger<Schema>::writeRows(std::vector<Source>& sources, const std::string& outputFile,
+                                              bool finalOutput, uint64_t* runChecksum) {
+    bool ok = false;
+    auto drain = [&](auto& out, auto&& mergeInto) {
+        if (!out.open(outputFile, sinkBufferSize_)) {
+            std::cerr << "Failed to open " << outputFile << std::endl;
+            return;
+        }
+        mergeInto(out);
+        ok = out.close();
+        if (!ok) std::cerr << "Failed to write " << outputFile << std::endl;
+        metrics_.addWrite(out.sink().bytesWritten(), out.sink().stallNanos());
+    };
+    auto mergeText = [&](auto& out) { mergeSources(sources, out, options_.kernel, metrics_); };
+    if (finalOutput && (options_.typed || options_.outputFormat != OutputFormat::Csv)) {
+        FieldDictionary exchanges;
+        FieldDictionary types;
+        std::vector<ColumnSource<Source>> columns(sources.size());
+        for (size_t i = 0; i < sources.size(); ++i) columns[i].attach(sources[i], exchanges, types, symbols_, metrics_);
+        auto mergeTyped = [&](auto& out) { mergeColumns(columns, out, options_.kernel, metrics_); };
+        if (options_.outputFormat == OutputFormat::Columnar) {
+            ColumnarWriter out(symbols_, exchanges, types, options_.chunkRows);
+            drain(out, mergeTyped);
+        }
+        else if (options_.outputFormat == OutputFormat::Bars) {
+            BarWriter out(symbols_, types, options_.barNanos);
+            drain(out, mergeTyped);
+        }
+        else {
+            ColumnCsvWriter out(symbols_, exchanges, types);
+            drain(out, mergeTyped);
+        }
+    }
+    else if (finalOutput) {
+        CsvWriter<Schema> out(symbols_);
+        drain(out, mergeText);
+    }
+    else {
+        RunWriter out;
+        drain(out, mergeText);
+        if (runChecksum) *runChecksum = out.checksum();
+    }
+    return ok;
+}
+
+template <typename Schema>
+size_t BasicMarketDataMerger<Schema>::buildIndexes() {
+    std::vector<std::string> files = getInputFiles();
+    std::atomic<size_t> written{0};
+    {
+        ThreadPool pool(std::min(options_.threads, std::max<size_t>(files.size(), 1)));
+        for (const auto& file : files) {
+            pool.submit([this, &file, &written] {
+                SparseIndex index;
+                if (index.load(file)) return; // Still current
+                uint64_t interval = std::max<uint64_t>(options_.indexInterval, 1);
+                if (index.build(file, parseKeyTimestamp<Schema>, interval) && index.save(file)) ++written;
+                else std::cerr << "Failed to index " << file << std::endl;
+            });
+        }
+        pool.wait();
     }
-    outFile << "Symbol,Timestamp,Price,Size,Exchange,Type\n"; // Write header
+    return written.load();
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergeToCoordinator(const std::string& address) {
+    stats_ = MergeStats();
+    metrics_.reset();
+    auto mergeStart = std::chrono::steady_clock::now();
+    std::unique_ptr<ProgressReporter> progress;
+    if (options_.progressSeconds > 0) progress = std::make_unique<ProgressReporter>(metrics_, options_.progressSeconds);
 
-    // Merge entries
-    while (!minHeap.empty()) {
-        MarketEntry entry = minHeap.top();
-        minHeap.pop();
-        outFile << entry.line << "\n";
+    std::vector<std::string> sources = loadInputs();
+    setUpReading(sources.size());
+    DescriptorBudget budget(filesOpenLimit_);
+    bool sourcesAreRuns = false;
+    bool ok = reduceSources(sources, sourcesAreRuns, budget);
 
-        // Declare 'line' in this scope
-        std::string line;
-        if (std::getline(fileStreams[entry.fileIndex], line)) {
-            size_t firstComma = line.find(',');
-            size_t secondComma = line.find(',', firstComma + 1);
-            if (firstComma != std::string::npos && secondComma != std::string::npos) {
-                std::string symbol = line.substr(0, firstComma);
-                std::string timestamp = line.substr(firstComma + 1, secondComma - firstComma - 1);
-                minHeap.emplace(timestamp, symbol, line, entry.fileIndex);
+    // Every source is opened before connecting, so a worker missing an input fails without sending
+    DescriptorLease lease(budget, ok ? sources.size() : 0);
+    std::vector<RunFileSource> runs;
+    std::vector<InputFileSource<Schema>> inputs;
+    if (ok && sourcesAreRuns) {
+        runs = openSources<RunFileSource>(sources, readOptions_, sourceOptionsFor(options_, false), &ok);
+    }
+    else if (ok) {
+        inputs = openSources<InputFileSource<Schema>>(sources, readOptions_, sourceOptionsFor(options_, true), &ok);
+        for (size_t i = 0; i < inputs.size(); ++i) inputs[i].current.symbolId = symbols_.id(extractSymbol(sources[i]));
+    }
+
+    // Connecting only now keeps the coordinator from waiting on a socket during the group passes
+    RunStreamSender sender;
+    if (ok && !(sender.connect(address) && sender.sendHello(symbols_))) {
+        std::cerr << "Failed to connect to coordinator " << address << std::endl;
+        ok = false;
+    }
+    if (ok) {
+        ++stats_.passes;
+        PhaseTimer timer(stats_.finalMergeSeconds);
+        if (sourcesAreRuns) {
+            mergeSources(runs, sender, options_.kernel, metrics_);
+            ok = sourcesRead(runs, sources);
+            addReadMetrics(runs, sources, metrics_);
+        }
+        else {
+            mergeReduced(inputs, reduceOptionsFor<Schema>(options_), options_.kernel, metrics_,
+                         [&](auto& merged) { mergeSources(merged, sender, options_.kernel, metrics_); });
+            ok = sourcesRead(inputs, sources);
+            addReadMetrics(inputs, sources, metrics_);
+            for (size_t i = 0; i < inputs.size(); ++i) inputs[i].saveIndex(sources[i]);
+        }
+        // After a failed read no END is sent: the sender just drops the connection, which fails the
+        // coordinator's merge as well
+        if (ok && !sender.close()) {
+            std::cerr << "Lost connection to coordinator " << address << std::endl;
+            ok = false;
+        }
+        metrics_.addWrite(sender.bytesSent(), sender.stallNanos());
+    }
+    runs.clear(); // Closed before their files are removed
+    inputs.clear();
+    if (sourcesAreRuns) {
+        PhaseTimer cleanup(stats_.cleanupSeconds);
+        removeTemporaryFiles(sources);
+    }
+    readOptions_ = ReadOptions();
+    prefetchPool_.reset();
+    arena_.reset();
+    progress.reset();
+
+    metrics_.fill(stats_);
+    stats_.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart).count();
+    if (!options_.metricsFile.empty() && !metrics_.writeJson(options_.metricsFile, stats_)) {
+        std::cerr << "Failed to write " << options_.metricsFile << std::endl;
+    }
+    return ok;
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::mergeFromWorkers(uint16_t port, size_t workers) {
+    stats_ = MergeStats();
+    metrics_.reset();
+    auto mergeStart = std::chrono::steady_clock::now();
+
+    RunStreamListener listener;
+    if (!listener.listen(port)) {
+        std::cerr << "Failed to listen on port " << port << std::endl;
+        return false;
+    }
+    std::vector<NetworkSource> sources(workers);
+    std::vector<std::string> peers(workers);
+    std::vector<std::vector<std::string>> workerSymbols(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        int fd = listener.accept(peers[i]);
+        if (fd < 0 || !sources[i].receiver.attach(fd, workerSymbols[i])) {
+            std::cerr << "Failed to accept worker " << (peers[i].empty() ? std::to_string(i) : peers[i]) << std::endl;
+            return false;
+        }
+    }
+
+    // Names sort the same everywhere, so mapping each worker's ids into the sorted union keeps
+    // every stream in key order
+    std::vector<std::string> names;
+    for (const auto& list : workerSymbols) names.insert(names.end(), list.begin(), list.end());
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    symbols_ = SymbolTable(std::move(names));
+    for (size_t i = 0; i < workers; ++i) {
+        std::vector<uint32_t> symbolMap;
+        symbolMap.reserve(workerSymbols[i].size());
+        for (const auto& name : workerSymbols[i]) symbolMap.push_back(symbols_.id(name));
+        if (!sources[i].receiver.start(std::move(symbolMap))) {
+            std::cerr << "Lost connection to worker " << peers[i] << std::endl;
+            return false;
+        }
+    }
+
+    std::unique_ptr<ProgressReporter> progress;
+    if (options_.progressSeconds > 0) progress = std::make_unique<ProgressReporter>(metrics_, options_.progressSeconds);
+    sinkBufferSize_ = BufferedSink::DEFAULT_BUFFER_SIZE;
+    ++stats_.passes;
+    bool ok;
+    {
+        PhaseTimer timer(stats_.finalMergeSeconds);
+        ok = writeMerged(sources, peers, outputFile_, true, nullptr);
+    }
+    progress.reset();
+
+    for (size_t i = 0; i < workers; ++i) {
+        if (sources[i].receiver.failed()) {
+            std::cerr << "Lost connection to worker " << peers[i] << std::endl;
+            ok = false;
+        }
+    }
+
+    metrics_.fill(stats_);
+    reportRejectedTotal(stats_.recordsRejected);
+    stats_.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mergeStart).count();
+    if (!options_.metricsFile.empty() && !metrics_.writeJson(options_.metricsFile, stats_)) {
+        std::cerr << "Failed to write " << options_.metricsFile << std::endl;
+    }
+    return ok;
+}
+
+template <typename Schema>
+void BasicMarketDataMerger<Schema>::stopFollowing() {
+    followStopRequested.store(true);
+}
+
+template <typename Schema>
+bool BasicMarketDataMerger<Schema>::follow(const std::vector<std::string>& files) {
+    // Every tailed input stays open for the whole run, so there is no pass plan to fall back on
+    if (files.size() > filesOpenLimit_) {
+        std::cerr << "Follow mode keeps every input open: " << files.size() << " inputs exceed the limit of "
+                  << filesOpenLimit_ << " open files; narrow them with --symbols" << std::endl;
+        return false;
+    }
+    ReadOptions readOptions;
+    readOptions.follow = true;
+    readOptions.readCounter = metrics_.readCounter();
+    std::vector<FollowSource<Schema>> sources(files.size());
+    std::unordered_map<std::string, size_t> byName; // File name without directory -> source
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!sources[i].reader.open(files[i], readOptions)) {
+            std::cerr << "Failed to open " << files[i] << std::endl;
+            continue;
+        }
+        sources[i].symbolId = symbols_.id(extractSymbol(files[i]));
+        sources[i].lastActivity = now;
+        sources[i].window = options_.window;
+        byName[fs::path(files[i]).filename().string()] = i;
+    }
+
+    CsvWriter<Schema> out(symbols_);
+    if (!out.open(outputFile_)) {
+        std::cerr << "Failed to open " << outputFile_ << std::endl;
+        return false;
+    }
+    FileWatcher watcher;
+    watcher.watch(inputDir_);
+
+    // A row (t, s) is safe to emit once it is <= (watermark, symbol) of every live source: each
+    // source only appends rows at or after its watermark, and its own ties keep file order.
+    // Sources idle for longer than followIdleSeconds stop holding the rest back.
+    const std::chrono::duration<double> idleLimit(options_.followIdleSeconds);
+    MergeKey emitted{INT64_MIN, 0};
+    uint64_t late = 0;
+    std::vector<size_t> changed(sources.size());
+    for (size_t i = 0; i < changed.size(); ++i) changed[i] = i;
+    std::vector<std::string> names;
+    std::vector<FollowBatchSource<Schema>> batch;
+
+    followStopRequested.store(false);
+    for (;;) {
+        bool stopping = followStopRequested.load();
+        if (stopping) {
+            // One last read of everything, taking unterminated last lines as complete like a batch merge
+            changed.resize(sources.size());
+            for (size_t i = 0; i < changed.size(); ++i) {
+                changed[i] = i;
+                sources[i].reader.stopFollowing();
+            }
+        }
+        now = std::chrono::steady_clock::now();
+        for (size_t i : changed) {
+            if (sources[i].reader.isOpen() && sources[i].poll(emitted, late)) sources[i].lastActivity = now;
+        }
+
+        MergeKey bound{INT64_MAX, UINT32_MAX};
+        if (!stopping) {
+            for (const FollowSource<Schema>& source : sources) {
+                if (!source.reader.isOpen()) continue;
+                if (options_.followIdleSeconds > 0 && now - source.lastActivity > idleLimit) continue;
+                bound = std::min(bound, MergeKey{source.watermark, source.symbolId});
             }
         }
+
+        batch.clear();
+        for (FollowSource<Schema>& source : sources) {
+            size_t end = source.head;
+            while (end < source.rows.size() && !(bound < MergeKey{source.rows[end].timestamp, source.symbolId})) ++end;
+            if (end == source.head) continue;
+            emitted = std::max(emitted, MergeKey{source.rows[end - 1].timestamp, source.symbolId});
+            FollowBatchSource<Schema> part;
+            part.source = &source;
+            part.pos = source.head;
+            part.end = end;
+            batch.push_back(part);
+            source.head = end;
+        }
+        if (!batch.empty()) {
+            mergeSources(batch, out, options_.kernel, metrics_);
+            out.flush(); // Hand the round to the writer thread right away for low latency
+            for (FollowBatchSource<Schema>& part : batch) part.source->compact();
+        }
+        if (stopping) break;
+
+        changed.clear();
+        names.clear();
+        if (watcher.wait(FOLLOW_POLL_MILLIS, names)) {
+            for (const auto& name : names) {
+                auto it = byName.find(name);
+                if (it != byName.end()) changed.push_back(it->second);
+            }
+        }
+        else {
+            for (size_t i = 0; i < sources.size(); ++i) changed.push_back(i);
+        }
+    }
+
+    bool ok = out.close();
+    if (!ok) std::cerr << "Failed to write " << outputFile_ << std::endl;
+    metrics_.addWrite(out.sink().bytesWritten(), out.sink().stallNanos());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const FileReader& file = sources[i].reader;
+        if (file.failed()) {
+            std::cerr << "Failed to read " << files[i] << std::endl;
+            ok = false;
+        }
+        metrics_.addRead(0, file.stallNanos()); // The bytes were counted as they were read
+        metrics_.addSource({files[i], file.bytesRead(), static_cast<double>(file.stallNanos()) / 1e9});
+    }
+    if (late > 0) {
+        std::cerr << late << " rows arrived after later rows had been emitted and are out of order" << std::endl;
     }
+    return ok;
+}
 
-    for (auto& fs : fileStreams) {
-        if (fs.is_open()) fs.close();
+template <typename Schema>
+void BasicMarketDataMerger<Schema>::removeTemporaryFiles(const std::vector<std::string>& tempFiles) const {
+    for (const auto& tempFile : tempFiles) {
+        fs::remove(tempFile);
     }
 }
 
-std::string MarketDataMerger::extractSymbol(const std::string& filePath) const {
-    return fs::path(filePath).stem().string();
+template <typename Schema>
+std::string_view BasicMarketDataMerger<Schema>::extractSymbol(std::string_view filePath) {
+    // Same as fs::path::stem() (of "SYMBOL.txt" for "SYMBOL.txt.gz"), without building a path
+    size_t slash = filePath.find_last_of("/\\");
+    std::string_view name = withoutCompressionExtension(slash == std::string_view::npos ? filePath : filePath.substr(slash + 1));
+    size_t dot = name.rfind('.');
+    return dot == 0 || dot == std::string_view::npos ? name : name.substr(0, dot);
 }
 
-std::vector<std::string> MarketDataMerger::getInputFiles() const {
+template <typename Schema>
+std::vector<std::string> BasicMarketDataMerger<Schema>::getInputFiles() const {
+    std::vector<std::string> wanted = options_.symbols;
+    std::sort(wanted.begin(), wanted.end());
+    auto isWanted = [&wanted](std::string_view path) {
+        return wanted.empty() || std::binary_search(wanted.begin(), wanted.end(), extractSymbol(path));
+    };
+    auto pathOf = [this](const ManifestEntry& entry) { return (fs::path(inputDir_) / entry.name).string(); };
+
+    InputManifest manifest;
+    bool cached = options_.useManifest && manifest.load(inputDir_, Schema::COLUMNS);
+    bool changed = !cached || !manifest.current();
+    int64_t listedMtime = manifest.listedMtime();
+    if (changed) {
+        // List the directory, keeping what the manifest knows about files that are still there
+        listedMtime = options_.useManifest ? InputManifest::listingMtime(inputDir_) : 0;
+        std::vector<ManifestEntry> listed;
+        for (const auto& entry : fs::directory_iterator(inputDir_)) {
+            ManifestEntry input;
+            input.name = entry.path().filename().string();
+            std::string_view name = withoutCompressionExtension(input.name);
+            if (entry.is_regular_file() && name.size() > 4 && name.substr(name.size() - 4) == ".txt") {
+                listed.push_back(std::move(input));
+            }
+        }
+        auto byName = [](const ManifestEntry& a, const ManifestEntry& b) { return a.name < b.name; };
+        std::sort(listed.begin(), listed.end(), byName); // Ensure consistent ordering
+        for (ManifestEntry& input : listed) {
+            auto it = std::lower_bound(manifest.entries.begin(), manifest.entries.end(), input, byName);
+            if (it != manifest.entries.end() && it->name == input.name) input = std::move(*it);
+        }
+        manifest.entries = std::move(listed);
+    }
+
+    bool windowed = options_.window.from != INT64_MIN || options_.window.to != INT64_MAX;
+    if (options_.useManifest) {
+        // One stat per wanted input revalidates its entry. Windowed runs also note the first and
+        // last timestamps of inputs that changed, so inputs outside a window need not be opened.
+        std::vector<char> updated(manifest.entries.size(), 0);
+        std::vector<char> missing(manifest.entries.size(), 0);
+        auto revalidate = [&](size_t i) {
+            ManifestEntry& entry = manifest.entries[i];
+            std::string path = pathOf(entry);
+            uint64_t size;
+            int64_t mtime;
+            if (!SparseIndex::stat(path, size, mtime)) {
+                missing[i] = 1;
+                return;
+            }
+            if (size != entry.size || mtime != entry.mtime) {
+                entry = ManifestEntry{entry.name, size, mtime};
+                updated[i] = 1;
+            }
+            if (windowed && !entry.scanned) {
+                int64_t timestamp;
+                std::string last;
+                if (firstRowTimestamp<Schema>(path, 0, timestamp)) entry.firstTimestamp = timestamp;
+                // Reading backwards only works on plain files
+                if (compressionOf(path) == Compression::None && readLastRow(path, last) &&
+                    parseKeyTimestamp<Schema>(last, last.find(','), timestamp)) {
+                    entry.lastTimestamp = timestamp;
+                }
+                entry.scanned = true;
+                updated[i] = 1;
+            }
+        };
+        std::vector<size_t> checked;
+        for (size_t i = 0; i < manifest.entries.size(); ++i) {
+            if (isWanted(manifest.entries[i].name)) checked.push_back(i);
+        }
+        if (checked.size() > 1) {
+            ThreadPool pool(std::min(OPEN_THREADS, checked.size()));
+            for (size_t i : checked) pool.submit([&revalidate, i] { revalidate(i); });
+            pool.wait();
+        }
+        else {
+            for (size_t i : checked) revalidate(i);
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < manifest.entries.size(); ++i) {
+            changed = changed || updated[i] || missing[i];
+            if (missing[i]) continue;
+            if (kept != i) manifest.entries[kept] = std::move(manifest.entries[i]);
+            ++kept;
+        }
+        manifest.entries.resize(kept);
+        if (changed) manifest.save(inputDir_, Schema::COLUMNS, listedMtime); // A read-only input directory goes without
+    }
+
     std::vector<std::string> files;
-    for (const auto& entry : fs::directory_iterator(inputDir_)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
-            files.push_back(entry.path().string());
+    for (const ManifestEntry& entry : manifest.entries) {
+        // --symbols: files of other symbols are never opened
+        if (!isWanted(entry.name)) continue;
+        // Nor are inputs known to hold nothing inside the window (except in follow mode, where they may grow into it)
+        if (!options_.follow && (entry.firstTimestamp >= options_.window.to || entry.lastTimestamp < options_.window.from)) {
+            continue;
         }
+        files.push_back(pathOf(entry));
     }
-    std::sort(files.begin(), files.end()); // Ensure consistent ordering
     return files;
-}
\ No newline at end of file
+}
+
+template class BasicMarketDataMerger<TickSchema>;
+template class BasicMarketDataMerger<L2DeltaSchema>;
@@ -2,55 +2,219 @@
 #ifndef MARKET_DATA_MERGER_H
 #define MARKET_DATA_MERGER_H
 
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
-#include <queue>
-#include <fstream>
-
-// Structure to hold an entry in the min-heap
-struct MarketEntry {
-    std::string timestamp;
-    std::string symbol;
-    std::string line;
-    size_t fileIndex;
-
-    MarketEntry(const std::string& ts, const std::string& sym, const std::string& l, size_t idx)
-        : timestamp(ts), symbol(sym), line(l), fileIndex(idx) {
-    }
+#include "file_reader.h"
+#include "kway_merger.h"
+#include "merge_key.h"
+#include "merge_metrics.h"
+#include "merge_stream.h"
+#include "record_schema.h"
+#include "sparse_index.h"
+
+struct AppendState;
+class BufferArena;
+class DescriptorBudget;
+class MergeCheckpoint;
+class ThreadPool;
+
+// Layout of the final output file
+enum class OutputFormat {
+    Csv,      // "Symbol,<input row>" text, e.g. "Symbol,Timestamp,Price,Size,Exchange,Type"
+    Columnar, // Chunked, compressed columns with a time/symbol index (see columnar_file.h)
+    Bars      // OHLCV bars of the trades per symbol and MergeOptions::barNanos interval (see bar_writer.h)
 };
 
-// Custom comparator for the min-heap: sorts by timestamp, then symbol
-struct CompareMarketEntry {
-    bool operator()(const MarketEntry& a, const MarketEntry& b) const {
-        if (a.timestamp == b.timestamp) {
-            return a.symbol > b.symbol; // Alphabetical order for equal timestamps
-        }
-        return a.timestamp > b.timestamp;
-    }
+// Runtime tuning knobs for a merge run
+struct MergeOptions {
+    size_t threads = 1; // Worker threads used for the group merges of each pass
+    size_t partitions = 1; // Time slices merged at the same time into output segments (1 = off)
+    MergeKernel kernel = MergeKernel::LoserTree; // Selection structure of every k-way merge
+    IoMode io = IoMode::Stream;                  // How input and temp files are read
+    size_t prefetchThreads = 0;                  // Stream mode: I/O threads reading ahead of the merge (0 = off)
+    size_t prefetchDepth = 2;                    // Blocks read ahead per file when prefetching
+    size_t memoryBudget = 0;                     // Bytes for read and write buffers (0 = default buffer sizes)
+    std::string metricsFile;                     // Write MergeStats and per-source metrics here as JSON
+    double progressSeconds = 0;                  // Print a progress line this often (0 = never)
+    bool typed = false;              // Parse rows once into column batches and format the output from them
+    OutputFormat outputFormat = OutputFormat::Csv; // Columnar and bars imply typed parsing
+    size_t chunkRows = 65536;        // Columnar output: records per chunk
+    int64_t barNanos = 60000000000;  // Bars output: interval of each bar
+    TimeRange window;                // Only merge rows with timestamps in [from, to)
+    std::vector<std::string> symbols; // Only merge these symbols (empty = all)
+    bool dedup = false;              // Drop rows repeating an earlier row of the same symbol and timestamp
+    int64_t conflateNanos = 0;       // Keep the last row per symbol and quote side in each bucket this wide (0 = off)
+    bool follow = false;             // Tail the inputs as they grow until stopFollowing() is called
+    double followIdleSeconds = 5;    // Follow: a source silent this long stops holding back output (0 = never)
+    bool append = false;             // Add only the rows appended to the inputs since the last merge (CSV output)
+    bool useIndex = true;            // Seek with "<SYMBOL>.idx" sidecars, writing them when missing or stale
+    bool useManifest = true;         // List the inputs from the cached "<input_dir>/.mdm_manifest" (see input_manifest.h)
+    bool resume = false;             // Reuse the temp runs an interrupted merge checkpointed (see merge_checkpoint.h)
+    uint64_t indexInterval = SparseIndex::DEFAULT_INTERVAL; // Bytes of input between index samples
 };
 
-class MarketDataMerger {
+// Merges per-symbol input files whose rows follow 'Schema' (see record_schema.h). The members are
+// defined in market_data_merger.cpp and instantiated there for the schemas in record_schema.h.
+template <typename Schema>
+class BasicMarketDataMerger {
 public:
-    MarketDataMerger(const std::string& inputDir, const std::string& tempDir, const std::string& outputFile);
-    void merge();
+    BasicMarketDataMerger(const std::string& inputDir, const std::string& tempDir, const std::string& outputFile,
+                          const MergeOptions& options = MergeOptions());
+    ~BasicMarketDataMerger();
+
+    // Merges the inputs into the output file; false (the errors having been printed) if an input
+    // could not be read or a run or the output not written
+    bool merge();
+
+    // Merges the inputs for an in-process consumer instead of writing the output file. Group passes
+    // (if any) run before this returns; the final pass advances as batches are pulled. The merger
+    // must outlive the stream, and follow mode does not apply. If a group pass fails or an input
+    // cannot be opened, the stream is empty and failed().
+    MergeStream stream(size_t batchSize = MergeStream::DEFAULT_BATCH_SIZE);
+    const MergeStats& stats() const { return stats_; }
+
+    // Writes the sidecar index of every input (honouring the symbol filter) that has none or a
+    // stale one, on options.threads workers; returns how many were written
+    size_t buildIndexes();
+
+    // Distributed merge, worker side: merges this node's inputs (its shard of the symbols) with the
+    // usual group passes, then streams the final merge to the coordinator at 'address'
+    // ("host:port", see net_stream.h) instead of writing the output file
+    bool mergeToCoordinator(const std::string& address);
+
+    // Distributed merge, coordinator side: accepts 'workers' connections on 'port' and k-way merges
+    // their streams by time into the output file. Symbol ids follow the union of the workers'
+    // symbols, so the output matches a single-node merge of all inputs.
+    bool mergeFromWorkers(uint16_t port, size_t workers);
+
+    // Makes a running follow-mode merge emit what it has buffered and return; async-signal-safe
+    static void stopFollowing();
 
 private:
     std::string inputDir_;
     std::string tempDir_;
     std::string outputFile_;
-    static const size_t MAX_FILES_OPEN = 500; // Constraint on simultaneous file opens
+    MergeOptions options_;
+    SymbolTable symbols_; // Built from the input file names at the start of merge()
+    ReadOptions readOptions_; // How every source is opened; set up by setUpReading()
+    std::unique_ptr<ThreadPool> prefetchPool_; // I/O threads behind readOptions_.prefetchPool
+    std::unique_ptr<BufferArena> arena_;       // Read buffers behind readOptions_.arena
+    size_t sinkBufferSize_ = 0;                // Buffer size of every output writer; set by setUpReading()
+    MergeStats stats_;
+    MergeMetrics ownMetrics_;
+    MergeMetrics& metrics_; // ownMetrics_, or those of the merger this one merges a time slice for
+    static const size_t MAX_FILES_OPEN = 500; // Constraint on simultaneous file opens (across all workers)
+    size_t filesOpenLimit_ = MAX_FILES_OPEN;  // This merger's share of MAX_FILES_OPEN
+    std::string runPrefix_ = "temp_";         // File name prefix of this merger's temp runs
+    const std::unordered_map<std::string, uint64_t>* resumeOffsets_ = nullptr; // Append: where each input resumes
+    const std::unordered_map<std::string, uint64_t>* endOffsets_ = nullptr;    // Append: where each input ends
+    MergeCheckpoint* checkpoint_ = nullptr; // Temp runs completed by the multi-pass merge under way
+    static constexpr size_t MIN_READ_BUFFER = 4 << 10; // Limits of the buffer sizes a memory budget picks
+    static constexpr size_t MAX_READ_BUFFER = 4 << 20;
+    static constexpr size_t MIN_SINK_BUFFER = 64 << 10;
+    static const int FOLLOW_POLL_MILLIS = 100; // Follow: longest wait for file changes between watermark checks
+
+    // Time slice 'index' of 'parts' of a partitioned merge run by 'parent': merges into a segment
+    // with a share of the parent's threads and descriptors, counting into the parent's metrics
+    BasicMarketDataMerger(BasicMarketDataMerger& parent, const TimeRange& slice, size_t index, size_t parts);
+
+    // Lists the input files and builds symbols_ from their names
+    std::vector<std::string> loadInputs();
+
+    // Sets up readOptions_, the prefetch threads, the buffer arena and sinkBufferSize_ from options_,
+    // for a merge of 'sources' files
+    void setUpReading(size_t sources);
+
+    // Runs group passes until 'sources' fit in a single merge, setting 'sourcesAreRuns' if they are
+    // now temp runs; false if a pass failed (its completed runs are kept for --resume if checkpointed)
+    bool reduceSources(std::vector<std::string>& sources, bool& sourcesAreRuns, DescriptorBudget& budget);
+
+    // --resume: replaces 'sources' with the runs of the last pass the checkpoint holds complete
+    // (every run recorded and still intact) and returns the number of passes so skipped
+    size_t skipCompletedPasses(std::vector<std::string>& sources);
+
+    // Checkpoint digest of a merge of 'sources': the symbols, each input's name, size and mtime,
+    // and the settings that shape the runs
+    uint64_t jobDigest(const std::vector<std::string>& sources) const;
+
+    // Checkpoint digest of the group sources[start, end) of a pass: their names and, for runs,
+    // their recorded checksums; false if a source run was never recorded
+    bool groupDigest(const std::vector<std::string>& sources, size_t start, size_t end, bool sourcesAreRuns,
+                     uint64_t& digest) const;
 
-    // Merges a group of files into a temporary file
-    void mergeGroup(const std::vector<std::string>& files, const std::string& outputFile);
+    // Group size of a pass that merges 'sources' inputs or runs with 'passes' passes to go; the
+    // same for any thread count
+    size_t groupFanIn(size_t sources, size_t passes) const;
 
-    // Merges temporary files into the final output
-    void mergeTemporaryFiles(const std::vector<std::string>& tempFiles, const std::string& finalOutput);
+    // File name in tempDir_ of run 'group' of pass 'level'
+    std::string runName(size_t level, size_t group) const;
 
-    // Extracts symbol from file path
-    std::string extractSymbol(const std::string& filePath) const;
+    // Merges the sources in as few passes as MAX_FILES_OPEN allows, ending with 'outputFile'; false
+    // if any pass failed
+    bool mergePasses(std::vector<std::string> sources, const std::string& outputFile);
+
+    // Merges every input into the output file, partitioned if asked for
+    bool mergeAll(const std::vector<std::string>& files);
+
+    // --append: adds the new input rows to the output when its recorded state allows, else merges
+    // everything; then records the new state (only if the merge succeeded)
+    bool mergeAppending(const std::vector<std::string>& files);
+
+    // Merges the rows past each input's recorded size onto the end of the output; false (having
+    // written nothing) if the output must be merged from scratch instead, such as when the
+    // settings 'current' records differ from those of 'previous'
+    bool appendNewRows(const AppendState& previous, const AppendState& current, bool havePrevious,
+                       const std::vector<std::pair<std::string, uint64_t>>& sizes);
+
+    // Splits the window into options_.partitions time slices of about equal input size, merges
+    // them in parallel and concatenates the segments into the output file
+    bool mergePartitioned(const std::vector<std::string>& files);
+
+    // Merges one pass: groups of 'sources' (inputs, or runs of an earlier pass) into the temp runs
+    // 'runs'. False if a group failed; its run is then missing, and the others are complete.
+    bool mergeLevel(const std::vector<std::string>& sources, bool sourcesAreRuns, size_t level, size_t passes,
+                    DescriptorBudget& budget, std::vector<std::string>& runs);
+
+    // Merges a group of input files into a binary temp run (see run_file.h), or into the final
+    // text output if 'finalOutput'; holds one descriptor per input from 'budget'. False if a source
+    // could not be opened or the output not written; a run's checksum goes to 'runChecksum'.
+    bool mergeGroup(const std::vector<std::string>& files, const std::string& outputFile,
+                    DescriptorBudget& budget, bool finalOutput, uint64_t* runChecksum = nullptr);
+
+    // Merges temp runs into a new run, or into the final text output if 'finalOutput'
+    bool mergeTemporaryFiles(const std::vector<std::string>& tempFiles, const std::string& outputFile,
+                             DescriptorBudget& budget, bool finalOutput, uint64_t* runChecksum = nullptr);
+
+    // Runs the k-way merge over opened sources (read from 'paths') and writes it as a run or as
+    // the final output, recording I/O metrics. Inputs pass through the dedup/conflation stage.
+    template <typename Source>
+    bool writeMerged(std::vector<Source>& sources, const std::vector<std::string>& paths,
+                     const std::string& outputFile, bool finalOutput, uint64_t* runChecksum);
+
+    // Writes the merge of 'sources' to 'outputFile' in the format writeMerged() picked
+    template <typename Source>
+    bool writeRows(std::vector<Source>& sources, const std::string& outputFile, bool finalOutput,
+                   uint64_t* runChecksum);
+
+    // Follow mode: tails 'files' and emits each row once every live source's watermark has passed it
+    bool follow(const std::vector<std::string>& files);
+
+    void removeTemporaryFiles(const std::vector<std::string>& tempFiles) const;
+
+    // Extracts symbol from file path: the file name without extension, as a view into 'filePath'
+    static std::string_view extractSymbol(std::string_view filePath);
 
     // Gets all .txt files from the input directory
     std::vector<std::string> getInputFiles() const;
 };
 
+extern template class BasicMarketDataMerger<TickSchema>;
+extern template class BasicMarketDataMerger<L2DeltaSchema>;
+
+using MarketDataMerger = BasicMarketDataMerger<TickSchema>;
+
 #endif // MARKET_DATA_MERGER_H
\ No newline at end of file
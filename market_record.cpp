@@ -0,0 +1,99 @@
+// market_record.cpp
+#include "market_record.h"
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    return text;
+}
+
+// Splits off the field before the next comma (or the rest of 'text') and trims it
+std::string_view nextField(std::string_view& text) {
+    size_t comma = text.find(',');
+    std::string_view field = text.substr(0, comma);
+    text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+    return trim(field);
+}
+
+bool parseUnsigned(std::string_view text, uint32_t& value) {
+    if (text.empty() || text.size() > 10) return false;
+    uint64_t result = 0;
+    for (char c : text) {
+        unsigned digit = static_cast<unsigned char>(c) - '0';
+        if (digit > 9) return false;
+        result = result * 10 + digit;
+    }
+    if (result > UINT32_MAX) return false;
+    value = static_cast<uint32_t>(result);
+    return true;
+}
+
+} // namespace
+
+uint32_t FieldDictionary::id(std::string_view value) {
+    for (size_t i = 0; i < names_.size(); ++i) {
+        if (names_[i] == value) return static_cast<uint32_t>(i);
+    }
+    names_.emplace_back(value);
+    return static_cast<uint32_t>(names_.size() - 1);
+}
+
+bool parsePrice(std::string_view text, int64_t& price) {
+    bool negative = !text.empty() && text.front() == '-';
+    if (negative) text.remove_prefix(1);
+    size_t dot = text.find('.');
+    std::string_view whole = text.substr(0, dot);
+    std::string_view fraction = dot == std::string_view::npos ? std::string_view() : text.substr(dot + 1);
+    if ((whole.empty() && fraction.empty()) || whole.size() > 12 || fraction.size() > 6) return false;
+
+    int64_t value = 0;
+    for (char c : whole) {
+        unsigned digit = static_cast<unsigned char>(c) - '0';
+        if (digit > 9) return false;
+        value = value * 10 + digit;
+    }
+    int64_t scale = PRICE_SCALE;
+    for (char c : fraction) {
+        unsigned digit = static_cast<unsigned char>(c) - '0';
+        if (digit > 9) return false;
+        scale /= 10;
+        value = value * 10 + digit;
+    }
+    price = value * scale;
+    if (negative) price = -price;
+    return true;
+}
+
+void formatPrice(int64_t price, std::string& out) {
+    if (price < 0) {
+        out += '-';
+        price = -price;
+    }
+    out += std::to_string(price / PRICE_SCALE);
+    int64_t fraction = price % PRICE_SCALE;
+    if (fraction == 0) return;
+    char digits[8];
+    int length = 6;
+    for (int i = length - 1; i >= 0; --i, fraction /= 10) digits[i] = static_cast<char>('0' + fraction % 10);
+    while (digits[length - 1] == '0') --length;
+    out += '.';
+    out.append(digits, static_cast<size_t>(length));
+}
+
+bool parseRecordFields(std::string_view row, size_t firstComma, MarketRecord& record,
+                       FieldDictionary& exchanges, FieldDictionary& types) {
+    if (firstComma >= row.size()) return false;
+    std::string_view rest = row.substr(firstComma + 1);
+    std::string_view price = nextField(rest);
+    std::string_view size = nextField(rest);
+    std::string_view exchange = nextField(rest);
+    std::string_view type = nextField(rest);
+    if (!parsePrice(price, record.price) || !parseUnsigned(size, record.size) || exchange.empty() || type.empty()) {
+        return false;
+    }
+    record.exchange = exchanges.id(exchange);
+    record.type = types.id(type);
+    return true;
+}
@@ -0,0 +1,47 @@
+// market_record.h
+#ifndef MARKET_RECORD_H
+#define MARKET_RECORD_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Fixed-point scale of MarketRecord::price (6 decimal places)
+const int64_t PRICE_SCALE = 1000000;
+
+// One parsed input row (Timestamp,Price,Size,Exchange,Type) plus the symbol of its file
+struct MarketRecord {
+    int64_t timestamp = 0; // Nanoseconds since the Unix epoch
+    uint32_t symbolId = 0; // SymbolTable id
+    int64_t price = 0;     // Price * PRICE_SCALE
+    uint32_t size = 0;
+    uint32_t exchange = 0; // FieldDictionary ids
+    uint32_t type = 0;
+};
+
+// Interns the values of a low-cardinality text field (exchange, type) into dense ids in order
+// of first appearance
+class FieldDictionary {
+public:
+    // Returns the id of 'value', adding it if needed
+    uint32_t id(std::string_view value);
+    const std::string& name(uint32_t id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+
+private:
+    std::vector<std::string> names_; // A handful of entries, so a linear scan beats hashing
+};
+
+// Parses a decimal price ("228.5", "0.0001") into fixed point; false if malformed or too precise
+bool parsePrice(std::string_view text, int64_t& price);
+
+// Appends a fixed-point price in its shortest decimal form ("228.5")
+void formatPrice(int64_t price, std::string& out);
+
+// Parses the Price,Size,Exchange,Type fields of 'row', whose timestamp ends at 'firstComma'.
+// Blanks around fields are ignored. Timestamp and symbol are left to the caller.
+bool parseRecordFields(std::string_view row, size_t firstComma, MarketRecord& record,
+                       FieldDictionary& exchanges, FieldDictionary& types);
+
+#endif // MARKET_RECORD_H
@@ -0,0 +1,93 @@
+// merge_checkpoint.cpp
+#include "merge_checkpoint.h"
+#include "checksum.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const MAGIC = "MDMCHECKPOINT1";
+
+} // namespace
+
+MergeCheckpoint::~MergeCheckpoint() {
+    if (file_) std::fclose(file_);
+}
+
+std::string MergeCheckpoint::pathFor(const std::string& tempDir, const std::string& runPrefix) {
+    return (fs::path(tempDir) / (runPrefix + "checkpoint")).string();
+}
+
+bool MergeCheckpoint::start(const std::string& path, uint64_t job, bool resume) {
+    path_ = path;
+    runs_.clear();
+    if (resume) {
+        // A torn last line (the merge died while appending it) fails to parse and is dropped
+        std::ifstream in(path);
+        std::string magic;
+        uint64_t recordedJob = 0;
+        if (in >> magic >> recordedJob && magic == MAGIC && recordedJob == job) {
+            std::string name;
+            CheckpointRun run;
+            while (in >> name >> run.inputs >> run.size >> run.checksum) runs_[name] = run;
+        }
+    }
+    resumable_ = runs_.size();
+
+    // Rewrite the kept records so new ones never follow a torn line, then append to the result
+    std::string temp = path + ".tmp";
+    if (file_) std::fclose(file_);
+    file_ = std::fopen(temp.c_str(), "wb");
+    if (!file_) return false;
+    bool ok = std::fprintf(file_, "%s %llu\n", MAGIC, static_cast<unsigned long long>(job)) > 0;
+    for (const auto& run : runs_) ok = ok && append(run.first, run.second);
+    ok = std::fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    std::error_code error;
+    if (ok) fs::rename(temp, path, error);
+    if (!ok || error) {
+        fs::remove(temp, error);
+        return false;
+    }
+    file_ = std::fopen(path.c_str(), "ab");
+    return file_ != nullptr;
+}
+
+bool MergeCheckpoint::find(const std::string& name, CheckpointRun& run) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = runs_.find(name);
+    if (it == runs_.end()) return false;
+    run = it->second;
+    return true;
+}
+
+bool MergeCheckpoint::verify(const std::string& name, uint64_t inputs, const std::string& path) const {
+    CheckpointRun run;
+    if (!find(name, run) || run.inputs != inputs) return false;
+    std::error_code error;
+    if (fs::file_size(path, error) != run.size || error) return false; // Cheap check before reading it all
+    uint64_t size;
+    uint64_t checksum;
+    return fileChecksum(path, size, checksum) && size == run.size && checksum == run.checksum;
+}
+
+bool MergeCheckpoint::record(const std::string& name, const CheckpointRun& run) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    runs_[name] = run;
+    return file_ && append(name, run) && std::fflush(file_) == 0;
+}
+
+void MergeCheckpoint::remove() {
+    if (file_) std::fclose(file_);
+    file_ = nullptr;
+    runs_.clear();
+    std::error_code error;
+    if (!path_.empty()) fs::remove(path_, error);
+}
+
+bool MergeCheckpoint::append(const std::string& name, const CheckpointRun& run) {
+    return std::fprintf(file_, "%s %llu %llu %llu\n", name.c_str(), static_cast<unsigned long long>(run.inputs),
+                        static_cast<unsigned long long>(run.size), static_cast<unsigned long long>(run.checksum)) > 0;
+}
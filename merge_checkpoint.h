@@ -0,0 +1,64 @@
+// merge_checkpoint.h
+#ifndef MERGE_CHECKPOINT_H
+#define MERGE_CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// A completed temp run: what it was merged from, and what the file held when it was complete
+struct CheckpointRun {
+    uint64_t inputs = 0;   // Digest of the run's sources (see BasicMarketDataMerger::groupDigest())
+    uint64_t size = 0;
+    uint64_t checksum = 0; // StreamChecksum of the file
+};
+
+// Record of the temp runs a multi-pass merge has completed, kept as "<temp_dir>/<prefix>checkpoint".
+// Each run is appended as a text line as soon as it has been renamed into place, so after a crash
+// the file lists every run that is complete. The first line holds a digest of the inputs and
+// settings; a --resume merge only trusts runs recorded for the same digest, and each only while
+// its file still has the recorded size and checksum.
+class MergeCheckpoint {
+public:
+    MergeCheckpoint() = default;
+    ~MergeCheckpoint();
+
+    MergeCheckpoint(const MergeCheckpoint&) = delete;
+    MergeCheckpoint& operator=(const MergeCheckpoint&) = delete;
+
+    static std::string pathFor(const std::string& tempDir, const std::string& runPrefix);
+
+    // Starts the checkpoint at 'path' for the merge with digest 'job'. With 'resume', the runs an
+    // earlier merge of the same job recorded are kept; else any earlier checkpoint is dropped.
+    // False if the file cannot be written, in which case the merge goes without.
+    bool start(const std::string& path, uint64_t job, bool resume);
+
+    // The record of run 'name' (a file name in the temp directory); false if there is none
+    bool find(const std::string& name, CheckpointRun& run) const;
+
+    // Whether run 'name' was recorded as merged from sources with digest 'inputs' and the file
+    // at 'path' still holds it (reads the whole file)
+    bool verify(const std::string& name, uint64_t inputs, const std::string& path) const;
+
+    // Appends the record of a run just completed; safe to call from several threads
+    bool record(const std::string& name, const CheckpointRun& run);
+
+    // Runs recorded by the earlier merge that start() kept
+    size_t resumable() const { return resumable_; }
+
+    // Deletes the checkpoint once the merge is complete
+    void remove();
+
+private:
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, CheckpointRun> runs_;
+    size_t resumable_ = 0;
+
+    bool append(const std::string& name, const CheckpointRun& run);
+};
+
+#endif // MERGE_CHECKPOINT_H
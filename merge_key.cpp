@@ -0,0 +1,183 @@
+// merge_key.cpp
+#include "merge_key.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define MERGE_KEY_SWAR_TIMESTAMP 1
+#endif
+
+namespace {
+
+// Parses exactly 'count' decimal digits starting at 'p'
+bool parseDigits(const char* p, size_t count, int& value) {
+    value = 0;
+    for (size_t i = 0; i < count; ++i) {
+        unsigned digit = static_cast<unsigned char>(p[i]) - '0';
+        if (digit > 9) return false;
+        value = value * 10 + static_cast<int>(digit);
+    }
+    return true;
+}
+
+// Whether the date exists and all of its year fits int64 nanoseconds since the epoch
+// (1677-09-21 to 2262-04-11)
+bool validDate(int year, int month, int day) {
+    static const int DAYS_IN_MONTH[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (year < 1678 || year > 2261 || month < 1 || month > 12 || day < 1) return false;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return day <= DAYS_IN_MONTH[month - 1] + (month == 2 && leap ? 1 : 0);
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's days_from_civil)
+int64_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yearOfEra = year - era * 400;
+    const int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Inverse of daysFromCivil (H. Hinnant's civil_from_days)
+void civilFromDays(int64_t days, int& year, int& month, int& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t dayOfEra = days - era * 146097;
+    const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+}
+
+#ifdef MERGE_KEY_SWAR_TIMESTAMP
+// Loads 8 bytes little-endian, so byte i of the text is lane i of the word
+uint64_t loadWord(const char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// True when every lane selected by 'lanes' (0xFF per lane) holds an ASCII digit: the high
+// nibble is 3 and the low nibble plus 6 does not carry into bit 4
+bool allDigits(uint64_t word, uint64_t lanes) {
+    const uint64_t high = 0xF0F0F0F0F0F0F0F0ULL & lanes;
+    const uint64_t low = 0x0F0F0F0F0F0F0F0FULL & lanes;
+    return (word & high) == (0x3030303030303030ULL & lanes) &&
+           (((word & low) + (0x0606060606060606ULL & lanes)) & 0x1010101010101010ULL) == 0;
+}
+
+int lane(uint64_t word, unsigned index) {
+    return static_cast<int>((word >> (8 * index)) & 0x0F);
+}
+
+// Fast path for the exact "YYYY-MM-DD HH:MM:SS.mmm" form the feeds use: three overlapping 8-byte
+// loads (offsets 0, 8, 15) cover all 23 bytes, validated with a handful of masks instead of a
+// branch per character. Returns false when the text does not have this shape.
+bool parseMillisTimestamp(const char* p, int& year, int& month, int& day, int& hour, int& minute,
+                          int& second, int& millis) {
+    // Lanes: "YYYY-MM-" / "DD HH:MM" / "M:SS.mmm"
+    const uint64_t w0 = loadWord(p);
+    const uint64_t w1 = loadWord(p + 8);
+    const uint64_t w2 = loadWord(p + 15);
+    const uint64_t sep0 = 0xFF0000FF00000000ULL, sep1 = 0x0000FF0000FF0000ULL, sep2 = 0x000000FF0000FF00ULL;
+    if ((w0 & sep0) != 0x2D00002D00000000ULL || (w1 & sep1) != 0x00003A0000200000ULL ||
+        (w2 & sep2) != 0x0000002E00003A00ULL || !allDigits(w0, ~sep0) || !allDigits(w1, ~sep1) ||
+        !allDigits(w2, ~sep2)) {
+        return false;
+    }
+    year = lane(w0, 0) * 1000 + lane(w0, 1) * 100 + lane(w0, 2) * 10 + lane(w0, 3);
+    month = lane(w0, 5) * 10 + lane(w0, 6);
+    day = lane(w1, 0) * 10 + lane(w1, 1);
+    hour = lane(w1, 3) * 10 + lane(w1, 4);
+    minute = lane(w1, 6) * 10 + lane(w1, 7);
+    second = lane(w2, 2) * 10 + lane(w2, 3);
+    millis = lane(w2, 5) * 100 + lane(w2, 6) * 10 + lane(w2, 7);
+    return true;
+}
+#endif
+
+} // namespace
+
+bool parseTimestamp(std::string_view text, int64_t& nanos) {
+#ifdef MERGE_KEY_SWAR_TIMESTAMP
+    if (text.size() == 23) {
+        int year, month, day, hour, minute, second, millis;
+        if (parseMillisTimestamp(text.data(), year, month, day, hour, minute, second, millis)) {
+            if (!validDate(year, month, day) || hour > 23 || minute > 59 || second > 60) return false;
+            int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+            nanos = seconds * 1000000000LL + millis * 1000000LL;
+            return true;
+        }
+    }
+#endif
+    // Fixed-width prefix: YYYY-MM-DD HH:MM:SS
+    if (text.size() < 19 || text[4] != '-' || text[7] != '-' || text[10] != ' ' ||
+        text[13] != ':' || text[16] != ':') {
+        return false;
+    }
+    const char* p = text.data();
+    int year, month, day, hour, minute, second;
+    if (!parseDigits(p, 4, year) || !parseDigits(p + 5, 2, month) || !parseDigits(p + 8, 2, day) ||
+        !parseDigits(p + 11, 2, hour) || !parseDigits(p + 14, 2, minute) || !parseDigits(p + 17, 2, second)) {
+        return false;
+    }
+    if (!validDate(year, month, day) || hour > 23 || minute > 59 || second > 60) return false;
+
+    int64_t fraction = 0;
+    if (text.size() > 19) {
+        size_t digits = text.size() - 20;
+        if (text[19] != '.' || digits == 0 || digits > 9) return false;
+        int value;
+        if (!parseDigits(p + 20, digits, value)) return false;
+        fraction = value;
+        for (size_t i = digits; i < 9; ++i) fraction *= 10;
+    }
+
+    int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    nanos = seconds * 1000000000LL + fraction;
+    return true;
+}
+
+void formatTimestamp(int64_t nanos, std::string& out) {
+    int64_t seconds = nanos >= 0 ? nanos / 1000000000LL : -((-nanos + 999999999LL) / 1000000000LL);
+    int64_t fraction = nanos - seconds * 1000000000LL;
+    int64_t days = seconds >= 0 ? seconds / 86400 : -((-seconds + 86399) / 86400);
+    int64_t secondOfDay = seconds - days * 86400;
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+
+    int digits = 9;
+    while (digits > 3 && fraction % 10 == 0) {
+        fraction /= 10;
+        --digits;
+    }
+    if (digits > 3 && digits < 6) {
+        fraction *= digits == 4 ? 100 : 10;
+        digits = 6;
+    }
+    else if (digits > 6 && digits < 9) {
+        for (; digits < 9; ++digits) fraction *= 10;
+    }
+    char text[40];
+    int length = std::snprintf(text, sizeof(text), "%04d-%02d-%02d %02d:%02d:%02d.%0*lld", year, month, day,
+                               static_cast<int>(secondOfDay / 3600), static_cast<int>(secondOfDay / 60 % 60),
+                               static_cast<int>(secondOfDay % 60), digits, static_cast<long long>(fraction));
+    out.append(text, static_cast<size_t>(length));
+}
+
+SymbolTable::SymbolTable(std::vector<std::string> symbols)
+    : symbols_(std::move(symbols)) {
+    std::sort(symbols_.begin(), symbols_.end());
+    symbols_.erase(std::unique(symbols_.begin(), symbols_.end()), symbols_.end());
+}
+
+uint32_t SymbolTable::id(std::string_view symbol) const {
+    auto it = std::lower_bound(symbols_.begin(), symbols_.end(), symbol,
+                               [](const std::string& a, std::string_view b) { return std::string_view(a) < b; });
+    if (it == symbols_.end() || *it != symbol) return npos;
+    return static_cast<uint32_t>(it - symbols_.begin());
+}
@@ -0,0 +1,65 @@
+// merge_key.h
+#ifndef MERGE_KEY_H
+#define MERGE_KEY_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary sort key of a record: timestamp first, then symbol
+struct MergeKey {
+    int64_t timestamp; // Nanoseconds since the Unix epoch
+    uint32_t symbolId; // Dense id; ids follow alphabetical symbol order
+
+    bool operator<(const MergeKey& other) const {
+        return timestamp < other.timestamp || (timestamp == other.timestamp && symbolId < other.symbolId);
+    }
+    bool operator>(const MergeKey& other) const { return other < *this; }
+    bool operator==(const MergeKey& other) const {
+        return timestamp == other.timestamp && symbolId == other.symbolId;
+    }
+    bool operator!=(const MergeKey& other) const { return !(*this == other); }
+};
+
+// Half-open window [from, to) of timestamps; unbounded by default
+struct TimeRange {
+    int64_t from = INT64_MIN;
+    int64_t to = INT64_MAX;
+
+    bool contains(int64_t timestamp) const { return timestamp >= from && timestamp < to; }
+};
+
+// Parses "YYYY-MM-DD HH:MM:SS[.fraction]" (up to 9 fractional digits) into nanoseconds since the epoch.
+// Returns false if the text does not match that format, names a day that does not exist (2021-02-31)
+// or lies outside the years 1678 to 2261, which int64 nanoseconds cover in full.
+bool parseTimestamp(std::string_view text, int64_t& nanos);
+
+// Appends 'nanos' as "YYYY-MM-DD HH:MM:SS.fraction" with 3, 6 or 9 fractional digits, the fewest
+// that represent it exactly
+void formatTimestamp(int64_t nanos, std::string& out);
+
+// Index of the 'width' nanoseconds wide time bucket holding 'timestamp' (rounding down before 1970)
+inline int64_t timeBucket(int64_t timestamp, int64_t width) {
+    int64_t bucket = timestamp / width;
+    return timestamp % width < 0 ? bucket - 1 : bucket;
+}
+
+// Interns symbols into dense ids assigned in alphabetical order
+class SymbolTable {
+public:
+    static const uint32_t npos = UINT32_MAX;
+
+    SymbolTable() = default;
+    explicit SymbolTable(std::vector<std::string> symbols);
+
+    // Returns the id of 'symbol', or npos if it is not in the table
+    uint32_t id(std::string_view symbol) const;
+    const std::string& name(uint32_t id) const { return symbols_[id]; }
+    size_t size() const { return symbols_.size(); }
+
+private:
+    std::vector<std::string> symbols_; // Sorted and unique; index is the id
+};
+
+#endif // MERGE_KEY_H
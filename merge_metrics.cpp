@@ -0,0 +1,132 @@
+// merge_metrics.cpp
+#include "merge_metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+double seconds(uint64_t nanos) {
+    return static_cast<double>(nanos) / 1e9;
+}
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            out << escaped;
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void MergeMetrics::reset() {
+    records_ = 0;
+    dropped_ = 0;
+    rejected_ = 0;
+    bytesRead_ = 0;
+    bytesWritten_ = 0;
+    kernelOperations_ = 0;
+    kernelComparisons_ = 0;
+    readStallNanos_ = 0;
+    writeStallNanos_ = 0;
+    std::lock_guard<std::mutex> lock(sourcesMutex_);
+    sources_.clear();
+}
+
+void MergeMetrics::addRead(uint64_t bytes, uint64_t stallNanos) {
+    bytesRead_.fetch_add(bytes, std::memory_order_relaxed);
+    readStallNanos_.fetch_add(stallNanos, std::memory_order_relaxed);
+}
+
+void MergeMetrics::addWrite(uint64_t bytes, uint64_t stallNanos) {
+    bytesWritten_.fetch_add(bytes, std::memory_order_relaxed);
+    writeStallNanos_.fetch_add(stallNanos, std::memory_order_relaxed);
+}
+
+void MergeMetrics::addKernel(uint64_t operations, uint64_t comparisons) {
+    kernelOperations_.fetch_add(operations, std::memory_order_relaxed);
+    kernelComparisons_.fetch_add(comparisons, std::memory_order_relaxed);
+}
+
+void MergeMetrics::addSource(SourceMetrics source) {
+    std::lock_guard<std::mutex> lock(sourcesMutex_);
+    sources_.push_back(std::move(source));
+}
+
+void MergeMetrics::fill(MergeStats& stats) const {
+    stats.recordsMerged = records_;
+    stats.recordsDropped = dropped_;
+    stats.recordsRejected = rejected_;
+    stats.bytesRead = bytesRead_;
+    stats.bytesWritten = bytesWritten_;
+    stats.kernelOperations = kernelOperations_;
+    stats.kernelComparisons = kernelComparisons_;
+    stats.readStallSeconds = seconds(readStallNanos_);
+    stats.writeStallSeconds = seconds(writeStallNanos_);
+}
+
+bool MergeMetrics::writeJson(const std::string& path, const MergeStats& stats) const {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    out << "{\n"
+        << "  \"passes\": " << stats.passes << ",\n"
+        << "  \"seconds\": {\"total\": " << stats.totalSeconds << ", \"groupMerge\": " << stats.groupMergeSeconds
+        << ", \"finalMerge\": " << stats.finalMergeSeconds << ", \"cleanup\": " << stats.cleanupSeconds
+        << ", \"readStall\": " << stats.readStallSeconds << ", \"writeStall\": " << stats.writeStallSeconds << "},\n"
+        << "  \"recordsMerged\": " << stats.recordsMerged << ",\n"
+        << "  \"recordsDropped\": " << stats.recordsDropped << ",\n"
+        << "  \"recordsRejected\": " << stats.recordsRejected << ",\n"
+        << "  \"bytesRead\": " << stats.bytesRead << ",\n"
+        << "  \"bytesWritten\": " << stats.bytesWritten << ",\n"
+        << "  \"kernelOperations\": " << stats.kernelOperations << ",\n"
+        << "  \"kernelComparisons\": " << stats.kernelComparisons << ",\n"
+        << "  \"sources\": [";
+
+    std::lock_guard<std::mutex> lock(sourcesMutex_);
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        out << (i == 0 ? "\n" : ",\n") << "    {\"path\": ";
+        writeJsonString(out, sources_[i].path);
+        out << ", \"bytesRead\": " << sources_[i].bytesRead << ", \"stallSeconds\": " << sources_[i].stallSeconds << "}";
+    }
+    out << (sources_.empty() ? "]\n" : "\n  ]\n") << "}\n";
+    return static_cast<bool>(out);
+}
+
+ProgressReporter::ProgressReporter(const MergeMetrics& metrics, double intervalSeconds)
+    : metrics_(metrics) {
+    thread_ = std::thread([this, intervalSeconds] {
+        auto start = std::chrono::steady_clock::now();
+        auto interval = std::chrono::duration<double>(intervalSeconds);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_.wait_for(lock, interval, [this] { return stopping_; })) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            uint64_t records = metrics_.records();
+            std::cerr << "progress: " << elapsed << "s, " << records << " records ("
+                      << static_cast<uint64_t>(records / elapsed) << "/s), "
+                      << metrics_.bytesRead() / (1024 * 1024) << " MiB read, "
+                      << metrics_.bytesWritten() / (1024 * 1024) << " MiB written" << std::endl;
+        }
+    });
+}
+
+ProgressReporter::~ProgressReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_.notify_all();
+    thread_.join();
+}
@@ -0,0 +1,98 @@
+// merge_metrics.h
+#ifndef MERGE_METRICS_H
+#define MERGE_METRICS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Timings and totals of the last merge() call
+struct MergeStats {
+    size_t passes = 0;              // Merge passes run (1 = inputs merged straight into the output)
+    double groupMergeSeconds = 0;   // Passes writing temp runs
+    double finalMergeSeconds = 0;   // Pass writing the final output
+    double cleanupSeconds = 0;      // Removing consumed temp runs
+    double totalSeconds = 0;
+
+    uint64_t recordsMerged = 0;     // Records written, summed over all passes
+    uint64_t recordsDropped = 0;    // Rows removed by --dedup / --conflate
+    uint64_t recordsRejected = 0;   // Rows typed parsing cannot represent, left out of typed, columnar and bar output
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t kernelOperations = 0;  // Records advanced through the merge kernel
+    uint64_t kernelComparisons = 0;
+    double readStallSeconds = 0;    // Time blocked waiting for input data (page faults of --io=mmap are not timed)
+    double writeStallSeconds = 0;   // Time blocked waiting for the output writer
+};
+
+// I/O of one source in one merge
+struct SourceMetrics {
+    std::string path;
+    uint64_t bytesRead = 0;
+    double stallSeconds = 0;
+};
+
+// Counters shared by all merge workers. Workers accumulate locally and publish in batches, so
+// updates stay off the per-record path.
+class MergeMetrics {
+public:
+    void reset();
+
+    void addRecords(uint64_t count) { records_.fetch_add(count, std::memory_order_relaxed); }
+    void addRead(uint64_t bytes, uint64_t stallNanos);
+    // Counter behind bytesRead(), handed to readers as ReadOptions::readCounter so that they
+    // publish each block as they read it rather than when their merge ends
+    std::atomic<uint64_t>* readCounter() { return &bytesRead_; }
+    void addWrite(uint64_t bytes, uint64_t stallNanos);
+    void addKernel(uint64_t operations, uint64_t comparisons);
+    void addDropped(uint64_t count) { dropped_.fetch_add(count, std::memory_order_relaxed); }
+    void addRejected(uint64_t count) { rejected_.fetch_add(count, std::memory_order_relaxed); }
+    void addSource(SourceMetrics source);
+
+    uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t bytesRead() const { return bytesRead_.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+
+    // Copies the totals into 'stats' (timings are left alone)
+    void fill(MergeStats& stats) const;
+
+    // Writes 'stats' and the per-source table as JSON; false if the file cannot be written
+    bool writeJson(const std::string& path, const MergeStats& stats) const;
+
+private:
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> bytesRead_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> kernelOperations_{0};
+    std::atomic<uint64_t> kernelComparisons_{0};
+    std::atomic<uint64_t> readStallNanos_{0};
+    std::atomic<uint64_t> writeStallNanos_{0};
+    mutable std::mutex sourcesMutex_;
+    std::vector<SourceMetrics> sources_;
+};
+
+// Prints a progress line to std::cerr every 'intervalSeconds' until destroyed
+class ProgressReporter {
+public:
+    ProgressReporter(const MergeMetrics& metrics, double intervalSeconds);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+private:
+    const MergeMetrics& metrics_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable stop_;
+    bool stopping_ = false;
+};
+
+#endif // MERGE_METRICS_H
@@ -0,0 +1,38 @@
+// merge_stream.cpp
+#include "merge_stream.h"
+#include <algorithm>
+
+namespace {
+
+const SymbolTable NO_SYMBOLS;
+const FieldDictionary NO_VALUES;
+
+} // namespace
+
+MergeStream::MergeStream(std::unique_ptr<Impl> impl, size_t batchSize, bool failed)
+    : impl_(std::move(impl)), batchSize_(std::max<size_t>(batchSize, 1)), failed_(failed) {
+    if (failed_) impl_.reset();
+}
+
+const SymbolTable& MergeStream::symbols() const {
+    return impl_ && impl_->symbols ? *impl_->symbols : NO_SYMBOLS;
+}
+
+const FieldDictionary& MergeStream::exchanges() const {
+    return impl_ ? impl_->exchanges : NO_VALUES;
+}
+
+const FieldDictionary& MergeStream::types() const {
+    return impl_ ? impl_->types : NO_VALUES;
+}
+
+bool MergeStream::next(RecordBatch& batch) {
+    batch.clear();
+    if (!impl_) return false;
+    batch.reserve(batchSize_);
+    // A malformed tail can leave a fill empty without ending the merge
+    while (batch.empty()) {
+        if (!impl_->fill(batch, batchSize_)) return !batch.empty();
+    }
+    return true;
+}
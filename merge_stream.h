@@ -0,0 +1,91 @@
+// merge_stream.h
+#ifndef MERGE_STREAM_H
+#define MERGE_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include "market_record.h"
+#include "merge_key.h"
+
+using RecordBatch = std::vector<MarketRecord>;
+
+// Pull interface to a merged stream of typed records, handed out in batches:
+//   for (const RecordBatch& batch : merger.stream()) { ... }
+// Records are parsed from the final merge pass as it goes, so nothing is written to the output file.
+class MergeStream {
+public:
+    static const size_t DEFAULT_BATCH_SIZE = 4096; // 128 KiB of records, comfortably inside L2
+
+    // The merge behind a stream; implemented by MarketDataMerger for its source types
+    struct Impl {
+        const SymbolTable* symbols = nullptr;
+        FieldDictionary exchanges;
+        FieldDictionary types;
+        uint64_t rejected = 0; // Rows left out because their fields do not parse
+        bool failed = false;   // A source could not be read to its end
+
+        virtual ~Impl() = default;
+        // Appends up to 'count' records to 'batch'; false once the merge is exhausted
+        virtual bool fill(RecordBatch& batch, size_t count) = 0;
+    };
+
+    // A 'failed' stream (the merge could not be set up, the errors having been printed) has no records
+    MergeStream(std::unique_ptr<Impl> impl, size_t batchSize, bool failed = false);
+    MergeStream(MergeStream&&) = default;
+    MergeStream& operator=(MergeStream&&) = default;
+
+    // Replaces 'batch' with the next records in merge order; false (with 'batch' empty) at the end
+    bool next(RecordBatch& batch);
+
+    // True if the merge could not be set up (a group pass failed, an input could not be opened, ...)
+    // or, once it has ended, if a source could not be read to its end (corrupt compressed data, a
+    // read error). An empty stream that did not fail is an empty merge.
+    bool failed() const { return failed_ || (impl_ && impl_->failed); }
+
+    // Names behind MarketRecord::symbolId, exchange and type; exchanges and types grow as rows are
+    // read. Empty for a failed stream.
+    const SymbolTable& symbols() const;
+    const FieldDictionary& exchanges() const;
+    const FieldDictionary& types() const;
+
+    // Rows left out so far because typed parsing cannot represent them (a price with more than 6
+    // decimals, a non-numeric size, ...); the text output keeps such rows
+    uint64_t rejected() const { return impl_ ? impl_->rejected : 0; }
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = RecordBatch;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const RecordBatch*;
+        using reference = const RecordBatch&;
+
+        explicit iterator(MergeStream* stream = nullptr) : stream_(stream) {}
+        reference operator*() const { return stream_->batch_; }
+        pointer operator->() const { return &stream_->batch_; }
+        iterator& operator++() {
+            if (!stream_->next(stream_->batch_)) stream_ = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return stream_ == other.stream_; }
+        bool operator!=(const iterator& other) const { return stream_ != other.stream_; }
+
+    private:
+        MergeStream* stream_; // Null at the end
+    };
+
+    // Single pass: begin() fetches the first batch
+    iterator begin() { return ++iterator(this); }
+    iterator end() { return iterator(); }
+
+private:
+    std::unique_ptr<Impl> impl_;
+    size_t batchSize_;
+    bool failed_;
+    RecordBatch batch_; // Current batch of the range-for interface
+};
+
+#endif // MERGE_STREAM_H
@@ -0,0 +1,415 @@
+// net_stream.cpp
+#include "net_stream.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint32_t VERSION = 1;
+const uint32_t FRAME_HELLO = 1;
+const uint32_t FRAME_DATA = 2;
+const uint32_t FRAME_END = 3;
+const uint32_t FRAME_CREDIT = 4;
+const uint32_t MAX_FRAME_BYTES = 1u << 30; // Anything larger is a corrupt stream
+const size_t RECORD_HEADER_BYTES = 16;
+
+void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+void putU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+uint64_t getLE(const char* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return value;
+}
+
+uint64_t nanosSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+#ifndef _WIN32
+bool sendAll(int fd, const char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // A vanished peer is reported as an error, not SIGPIPE
+#else
+    const int flags = 0;
+#endif
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, flags);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool recvAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = ::recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+// Frame header (type, length) followed by the payload
+bool sendMessage(int fd, uint32_t type, std::string_view payload) {
+    std::string header;
+    putU32(header, type);
+    putU32(header, static_cast<uint32_t>(payload.size()));
+    return sendAll(fd, header.data(), header.size()) && sendAll(fd, payload.data(), payload.size());
+}
+
+bool recvHeader(int fd, uint32_t& type, uint32_t& length) {
+    char header[8];
+    if (!recvAll(fd, header, sizeof(header))) return false;
+    type = static_cast<uint32_t>(getLE(header, 4));
+    length = static_cast<uint32_t>(getLE(header + 4, 4));
+    return length <= MAX_FRAME_BYTES;
+}
+#endif
+
+} // namespace
+
+// ---- RunStreamSender ----
+
+RunStreamSender::~RunStreamSender() {
+#ifndef _WIN32
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+bool RunStreamSender::connect(const std::string& address) {
+#ifndef _WIN32
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return false;
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CONNECT_RETRY_MILLIS);
+    for (;;) {
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* list = nullptr;
+        if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &list) != 0) return false;
+        for (struct addrinfo* ai = list; ai && fd_ < 0; ai = ai->ai_next) {
+            int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) fd_ = fd;
+            else ::close(fd);
+        }
+        ::freeaddrinfo(list);
+        if (fd_ >= 0) break;
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    frame_.reserve(FRAME_BYTES + RECORD_HEADER_BYTES);
+    return true;
+#else
+    (void)address;
+    return false;
+#endif
+}
+
+bool RunStreamSender::sendHello(const SymbolTable& symbols) {
+    std::string payload;
+    putU32(payload, VERSION);
+    putU32(payload, static_cast<uint32_t>(symbols.size()));
+    for (uint32_t id = 0; id < symbols.size(); ++id) {
+        const std::string& name = symbols.name(id);
+        payload += static_cast<char>(name.size() & 0xFF);
+        payload += static_cast<char>((name.size() >> 8) & 0xFF);
+        payload += name;
+    }
+    return sendFrame(FRAME_HELLO, payload);
+}
+
+void RunStreamSender::write(const MergeKey& key, std::string_view payload) {
+    putU64(frame_, static_cast<uint64_t>(key.timestamp));
+    putU32(frame_, key.symbolId);
+    putU32(frame_, static_cast<uint32_t>(payload.size()));
+    frame_.append(payload.data(), payload.size());
+    if (frame_.size() >= FRAME_BYTES) flushData();
+}
+
+bool RunStreamSender::flushData() {
+#ifndef _WIN32
+    if (frame_.empty() || failed_) return !failed_;
+    auto start = std::chrono::steady_clock::now();
+    while (credit_ == 0) {
+        // Wait for the coordinator to consume a frame
+        uint32_t type;
+        uint32_t length;
+        char grant[4];
+        if (!recvHeader(fd_, type, length) || type != FRAME_CREDIT || length != 4 || !recvAll(fd_, grant, 4)) {
+            failed_ = true;
+            return false;
+        }
+        credit_ += static_cast<uint32_t>(getLE(grant, 4));
+    }
+    --credit_;
+    bool sent = sendFrame(FRAME_DATA, frame_);
+    stallNanos_ += nanosSince(start);
+    frame_.clear();
+    return sent;
+#else
+    return false;
+#endif
+}
+
+bool RunStreamSender::sendFrame(uint32_t type, std::string_view payload) {
+#ifndef _WIN32
+    if (fd_ < 0 || failed_ || !sendMessage(fd_, type, payload)) {
+        failed_ = true;
+        return false;
+    }
+    bytesSent_ += 8 + payload.size();
+    return true;
+#else
+    (void)type;
+    (void)payload;
+    return false;
+#endif
+}
+
+bool RunStreamSender::close() {
+#ifndef _WIN32
+    bool ok = flushData() && sendFrame(FRAME_END, std::string_view());
+    if (fd_ >= 0) {
+        ::shutdown(fd_, SHUT_WR);
+        // Wait for the coordinator to hang up, so END is known to have arrived before we exit
+        char drain[64];
+        while (::recv(fd_, drain, sizeof(drain), 0) > 0) {
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+    return ok;
+#else
+    return false;
+#endif
+}
+
+// ---- RunStreamListener ----
+
+RunStreamListener::~RunStreamListener() {
+#ifndef _WIN32
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+bool RunStreamListener::listen(uint16_t port) {
+#ifndef _WIN32
+    fd_ = ::socket(AF_INET6, SOCK_STREAM, 0);
+    bool ipv6 = fd_ >= 0;
+    if (!ipv6) fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd_ < 0) return false;
+    int one = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    int bound;
+    if (ipv6) {
+        int zero = 0;
+        ::setsockopt(fd_, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero)); // Accept IPv4 as well
+        struct sockaddr_in6 addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        bound = ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+    else {
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        bound = ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+    return bound == 0 && ::listen(fd_, 64) == 0;
+#else
+    (void)port;
+    return false;
+#endif
+}
+
+int RunStreamListener::accept(std::string& peer) {
+#ifndef _WIN32
+    struct sockaddr_storage addr;
+    socklen_t length = sizeof(addr);
+    int fd;
+    do {
+        fd = ::accept(fd_, reinterpret_cast<struct sockaddr*>(&addr), &length);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) return -1;
+    char host[NI_MAXHOST];
+    char port[NI_MAXSERV];
+    if (::getnameinfo(reinterpret_cast<struct sockaddr*>(&addr), length, host, sizeof(host), port, sizeof(port),
+                      NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+        peer = std::string(host) + ":" + port;
+    }
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    return fd;
+#else
+    (void)peer;
+    return -1;
+#endif
+}
+
+// ---- RunStreamReceiver ----
+
+RunStreamReceiver::~RunStreamReceiver() {
+    close();
+}
+
+RunStreamReceiver::RunStreamReceiver(RunStreamReceiver&& other) noexcept {
+    *this = std::move(other);
+}
+
+RunStreamReceiver& RunStreamReceiver::operator=(RunStreamReceiver&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+        frame_ = std::move(other.frame_);
+        pos_ = other.pos_;
+        end_ = other.end_;
+        symbolMap_ = std::move(other.symbolMap_);
+        done_ = other.done_;
+        failed_ = other.failed_;
+        bytesRead_ = other.bytesRead_;
+        stallNanos_ = other.stallNanos_;
+    }
+    return *this;
+}
+
+void RunStreamReceiver::close() {
+#ifndef _WIN32
+    if (fd_ >= 0) ::close(fd_);
+#endif
+    fd_ = -1;
+}
+
+bool RunStreamReceiver::attach(int fd, std::vector<std::string>& symbols) {
+    close();
+    fd_ = fd;
+    uint32_t type;
+    if (!readFrame(type) || type != FRAME_HELLO || end_ < 8 || getLE(frame_.data(), 4) != VERSION) {
+        failed_ = true;
+        return false;
+    }
+    size_t count = static_cast<size_t>(getLE(frame_.data() + 4, 4));
+    size_t pos = 8;
+    symbols.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (end_ - pos < 2) break;
+        size_t length = static_cast<size_t>(getLE(frame_.data() + pos, 2));
+        pos += 2;
+        if (end_ - pos < length) break;
+        symbols.emplace_back(frame_.data() + pos, length);
+        pos += length;
+    }
+    pos_ = end_ = 0;
+    if (symbols.size() != count) failed_ = true;
+    return !failed_;
+}
+
+bool RunStreamReceiver::start(std::vector<uint32_t> symbolMap) {
+    symbolMap_ = std::move(symbolMap);
+#ifndef _WIN32
+    std::string grant;
+    putU32(grant, CREDIT_WINDOW);
+    if (fd_ < 0 || !sendMessage(fd_, FRAME_CREDIT, grant)) failed_ = true;
+#else
+    failed_ = true;
+#endif
+    return !failed_;
+}
+
+bool RunStreamReceiver::readFrame(uint32_t& type) {
+#ifndef _WIN32
+    auto start = std::chrono::steady_clock::now();
+    uint32_t length;
+    bool ok = fd_ >= 0 && recvHeader(fd_, type, length);
+    if (ok) {
+        if (frame_.size() < length) frame_.resize(length);
+        ok = recvAll(fd_, frame_.data(), length);
+    }
+    stallNanos_ += nanosSince(start);
+    if (!ok) return false;
+    bytesRead_ += 8 + length;
+    pos_ = 0;
+    end_ = length;
+    return true;
+#else
+    (void)type;
+    return false;
+#endif
+}
+
+bool RunStreamReceiver::next(MergeKey& key, std::string_view& payload) {
+    while (pos_ == end_) {
+        if (done_ || failed_) return false;
+        uint32_t type;
+        if (!readFrame(type) || (type != FRAME_DATA && type != FRAME_END)) {
+            failed_ = true;
+            return false;
+        }
+        if (type == FRAME_END) {
+            done_ = true;
+            return false;
+        }
+#ifndef _WIN32
+        // The frame just read frees a slot in the window
+        std::string grant;
+        putU32(grant, 1);
+        if (!sendMessage(fd_, FRAME_CREDIT, grant)) {
+            failed_ = true;
+            return false;
+        }
+#endif
+    }
+    if (end_ - pos_ < RECORD_HEADER_BYTES) {
+        failed_ = true;
+        return false;
+    }
+    const char* p = frame_.data() + pos_;
+    uint32_t symbol = static_cast<uint32_t>(getLE(p + 8, 4));
+    uint32_t length = static_cast<uint32_t>(getLE(p + 12, 4));
+    if (end_ - pos_ - RECORD_HEADER_BYTES < length || symbol >= symbolMap_.size()) {
+        failed_ = true;
+        return false;
+    }
+    key.timestamp = static_cast<int64_t>(getLE(p, 8));
+    key.symbolId = symbolMap_[symbol];
+    payload = std::string_view(p + RECORD_HEADER_BYTES, length);
+    pos_ += RECORD_HEADER_BYTES + length;
+    return true;
+}
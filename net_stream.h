@@ -0,0 +1,121 @@
+// net_stream.h
+#ifndef NET_STREAM_H
+#define NET_STREAM_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "merge_key.h"
+
+// Framed TCP stream of merged records from a worker to the coordinator (POSIX only). Every
+// message is a frame: u32 type, u32 payload length, payload, all integers little-endian.
+//   HELLO  worker -> coordinator: u32 version, u32 symbol count, then per symbol u16 length + name
+//   DATA   worker -> coordinator: records, each i64 timestamp, u32 symbol id (in the worker's
+//          table), u32 row length and the row; keys ascend across the whole stream
+//   END    worker -> coordinator: the stream is complete
+//   CREDIT coordinator -> worker: u32 further DATA frames the worker may send
+// Flow control is credit based: a worker starts without credit, the coordinator grants
+// CREDIT_WINDOW frames after HELLO and one more for every frame it has consumed, so no more than
+// that many frames per worker are ever buffered between them.
+
+// Worker side: connects to the coordinator and sends its merged records
+class RunStreamSender {
+public:
+    static const size_t FRAME_BYTES = 64 << 10;       // DATA frames are cut at about this size
+    static const int CONNECT_RETRY_MILLIS = 30000;    // Keep retrying while the coordinator starts up
+
+    RunStreamSender() = default;
+    ~RunStreamSender();
+
+    RunStreamSender(const RunStreamSender&) = delete;
+    RunStreamSender& operator=(const RunStreamSender&) = delete;
+
+    // 'address' is "host:port"
+    bool connect(const std::string& address);
+
+    // Announces the symbols the record ids refer to; must precede the first write()
+    bool sendHello(const SymbolTable& symbols);
+
+    void write(const MergeKey& key, std::string_view payload);
+
+    // Sends the last DATA frame and END and closes the connection; false if anything failed
+    bool close();
+
+    uint64_t bytesSent() const { return bytesSent_; }
+    uint64_t stallNanos() const { return stallNanos_; } // Time spent waiting for credit or the network
+
+private:
+    int fd_ = -1;
+    std::string frame_; // DATA payload being filled
+    uint32_t credit_ = 0;
+    bool failed_ = false;
+    uint64_t bytesSent_ = 0;
+    uint64_t stallNanos_ = 0;
+
+    bool sendFrame(uint32_t type, std::string_view payload);
+    bool flushData();
+};
+
+// Coordinator side: accepts worker connections
+class RunStreamListener {
+public:
+    RunStreamListener() = default;
+    ~RunStreamListener();
+
+    RunStreamListener(const RunStreamListener&) = delete;
+    RunStreamListener& operator=(const RunStreamListener&) = delete;
+
+    bool listen(uint16_t port);
+
+    // Blocks for the next connection; returns its socket (owned by the caller) or -1
+    int accept(std::string& peer);
+
+private:
+    int fd_ = -1;
+};
+
+// Coordinator side: the record stream of one worker
+class RunStreamReceiver {
+public:
+    static const uint32_t CREDIT_WINDOW = 8;
+
+    RunStreamReceiver() = default;
+    ~RunStreamReceiver();
+
+    RunStreamReceiver(const RunStreamReceiver&) = delete;
+    RunStreamReceiver& operator=(const RunStreamReceiver&) = delete;
+    RunStreamReceiver(RunStreamReceiver&& other) noexcept;
+    RunStreamReceiver& operator=(RunStreamReceiver&& other) noexcept;
+
+    // Takes ownership of an accepted socket and reads the worker's HELLO
+    bool attach(int fd, std::vector<std::string>& symbols);
+
+    // Ids to report for the worker's symbol ids, then opens the credit window
+    bool start(std::vector<uint32_t> symbolMap);
+
+    // Loads the next record; false at END or on failure (see failed()). 'payload' stays valid
+    // until the next call.
+    bool next(MergeKey& key, std::string_view& payload);
+
+    bool failed() const { return failed_; }
+    uint64_t bytesRead() const { return bytesRead_; }
+    uint64_t stallNanos() const { return stallNanos_; }
+
+private:
+    int fd_ = -1;
+    std::vector<char> frame_;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+    std::vector<uint32_t> symbolMap_;
+    bool done_ = false;
+    bool failed_ = false;
+    uint64_t bytesRead_ = 0;
+    uint64_t stallNanos_ = 0;
+
+    // Reads one frame into frame_; false on a closed or broken connection
+    bool readFrame(uint32_t& type);
+    void close();
+};
+
+#endif // NET_STREAM_H
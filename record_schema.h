@@ -0,0 +1,96 @@
+// record_schema.h
+#ifndef RECORD_SCHEMA_H
+#define RECORD_SCHEMA_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "merge_key.h"
+
+// How the key column of a row spells its timestamp
+enum class TimestampFormat {
+    DateTime,    // "YYYY-MM-DD HH:MM:SS[.fraction]", see parseTimestamp()
+    EpochNanos,  // Integer nanoseconds since the Unix epoch
+    EpochMicros,
+    EpochMillis
+};
+
+// CONFLATION_COLUMN of a schema whose rows cannot be conflated
+constexpr size_t NO_COLUMN = SIZE_MAX;
+
+// A record schema is a struct of compile-time constants describing the rows of one feed:
+//   static constexpr const char* COLUMNS;  // Input header line; the output header is "Symbol" + DELIMITER + COLUMNS
+//   static constexpr char DELIMITER;       // Field separator
+//   static constexpr size_t KEY_COLUMN;    // Index of the timestamp field
+//   static constexpr TimestampFormat TIMESTAMP_FORMAT;
+//   static constexpr bool TICK_FIELDS;     // Rows are Timestamp,Price,Size,Exchange,Type (see market_record.h),
+//                                          // which typed parsing, columnar output and stream() need
+//   static constexpr size_t CONFLATION_COLUMN;      // Field that, with the symbol, groups rows for --conflate
+//   static constexpr const char* CONFLATION_EXEMPT; // Value of that field whose rows are never conflated
+// BasicMarketDataMerger is instantiated once per schema, so the row parsing below is specialized
+// for each feed at compile time and nothing branches on the layout per row.
+
+// Quotes and trades, as in input_dir/ (the default)
+struct TickSchema {
+    static constexpr const char* COLUMNS = "Timestamp,Price,Size,Exchange,Type";
+    static constexpr char DELIMITER = ',';
+    static constexpr size_t KEY_COLUMN = 0;
+    static constexpr TimestampFormat TIMESTAMP_FORMAT = TimestampFormat::DateTime;
+    static constexpr bool TICK_FIELDS = true;
+    static constexpr size_t CONFLATION_COLUMN = 4; // Quotes conflate per side; every trade is kept
+    static constexpr const char* CONFLATION_EXEMPT = "TRADE";
+};
+
+// Order book deltas from a binary feed's text dump, stamped in epoch nanoseconds
+struct L2DeltaSchema {
+    static constexpr const char* COLUMNS = "Sequence|Timestamp|Side|Price|Size|Action";
+    static constexpr char DELIMITER = '|';
+    static constexpr size_t KEY_COLUMN = 1;
+    static constexpr TimestampFormat TIMESTAMP_FORMAT = TimestampFormat::EpochNanos;
+    static constexpr bool TICK_FIELDS = false;
+    static constexpr size_t CONFLATION_COLUMN = NO_COLUMN; // Every delta changes the book
+    static constexpr const char* CONFLATION_EXEMPT = "";
+};
+
+template <TimestampFormat Format>
+bool parseTimestampField(std::string_view text, int64_t& nanos) {
+    if constexpr (Format == TimestampFormat::DateTime) {
+        return parseTimestamp(text, nanos);
+    }
+    else {
+        constexpr int64_t scale = Format == TimestampFormat::EpochNanos ? 1 : Format == TimestampFormat::EpochMicros ? 1000 : 1000000;
+        int64_t value;
+        const char* end = text.data() + text.size();
+        auto result = std::from_chars(text.data(), end, value);
+        if (result.ec != std::errc() || result.ptr != end) return false;
+        nanos = value * scale;
+        return true;
+    }
+}
+
+// Parses the key timestamp of a data row. 'firstComma' is the offset of the row's first ',' (or
+// npos), which FileReader's line scan finds for free; schemas keyed on a leading comma-separated
+// field use it instead of searching the row.
+template <typename Schema>
+bool parseKeyTimestamp(std::string_view row, size_t firstComma, int64_t& timestamp) {
+    std::string_view field;
+    if constexpr (Schema::DELIMITER == ',' && Schema::KEY_COLUMN == 0) {
+        if (firstComma == std::string_view::npos) return false;
+        field = row.substr(0, firstComma);
+    }
+    else {
+        (void)firstComma;
+        size_t start = 0;
+        for (size_t column = 0; column < Schema::KEY_COLUMN; ++column) {
+            size_t delimiter = row.find(Schema::DELIMITER, start);
+            if (delimiter == std::string_view::npos) return false;
+            start = delimiter + 1;
+        }
+        size_t end = row.find(Schema::DELIMITER, start);
+        field = row.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+    }
+    return parseTimestampField<Schema::TIMESTAMP_FORMAT>(field, timestamp);
+}
+
+#endif // RECORD_SCHEMA_H
@@ -0,0 +1,80 @@
+// row_reducer.cpp
+#include "row_reducer.h"
+#include <functional>
+
+RowReducer::RowReducer(const ReduceOptions& options)
+    : options_(options), bucketNanos_(options.conflateNanos > 0 ? options.conflateNanos : 1) {}
+
+bool RowReducer::accepts(const MergeKey& key) const {
+    return rows_.empty() || timeBucket(key.timestamp, bucketNanos_) == bucket_;
+}
+
+void RowReducer::add(const MergeKey& key, std::string_view payload) {
+    if (rows_.empty()) bucket_ = timeBucket(key.timestamp, bucketNanos_);
+    uint32_t index = static_cast<uint32_t>(rows_.size());
+    uint32_t sameHash = NONE;
+    if (options_.dedup) {
+        uint64_t hash = std::hash<std::string_view>()(payload) ^ (key.symbolId * 0x9E3779B97F4A7C15ull);
+        auto [slot, inserted] = lastByHash_.try_emplace(hash, index);
+        if (!inserted) {
+            if (isDuplicate(key, payload, slot->second)) {
+                ++dropped_;
+                return;
+            }
+            sameHash = slot->second;
+            slot->second = index;
+        }
+    }
+    if (options_.conflateNanos > 0) {
+        std::string_view group = groupField(payload);
+        if (group != options_.keepGroup) {
+            uint64_t id = static_cast<uint64_t>(key.symbolId) << 32 | groups_.id(group);
+            auto [slot, inserted] = lastByGroup_.try_emplace(id, index);
+            if (!inserted) {
+                rows_[slot->second].superseded = true;
+                slot->second = index;
+                ++dropped_;
+            }
+        }
+    }
+    rows_.push_back({key, text_.size(), payload.size(), sameHash, false});
+    text_.append(payload.data(), payload.size());
+}
+
+bool RowReducer::next(MergeKey& key, std::string_view& payload) {
+    while (cursor_ < rows_.size()) {
+        const Row& row = rows_[cursor_++];
+        if (row.superseded) continue;
+        key = row.key;
+        payload = text(row);
+        return true;
+    }
+    rows_.clear();
+    text_.clear();
+    cursor_ = 0;
+    lastByHash_.clear();
+    lastByGroup_.clear();
+    return false;
+}
+
+// Walks the rows of the bucket sharing the hash, starting with the latest at 'index'
+bool RowReducer::isDuplicate(const MergeKey& key, std::string_view payload, uint32_t index) const {
+    for (; index != NONE; index = rows_[index].sameHash) {
+        const Row& row = rows_[index];
+        if (row.key.symbolId == key.symbolId && row.key.timestamp == key.timestamp && text(row) == payload) return true;
+    }
+    return false;
+}
+
+std::string_view RowReducer::groupField(std::string_view payload) const {
+    size_t start = 0;
+    for (size_t column = 0; column < options_.groupColumn; ++column) {
+        size_t delimiter = payload.find(options_.delimiter, start);
+        if (delimiter == std::string_view::npos) return std::string_view();
+        start = delimiter + 1;
+    }
+    std::string_view field = payload.substr(start, payload.find(options_.delimiter, start) - start);
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) field.remove_prefix(1);
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\t')) field.remove_suffix(1);
+    return field;
+}
@@ -0,0 +1,71 @@
+// row_reducer.h
+#ifndef ROW_REDUCER_H
+#define ROW_REDUCER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "market_record.h"
+#include "merge_key.h"
+
+// Which rows the reduce stage drops (both off: the stage is skipped)
+struct ReduceOptions {
+    bool dedup = false;         // Drop rows equal to an earlier row of the same symbol and timestamp
+    int64_t conflateNanos = 0;  // Keep only the last row per symbol and group in each bucket this wide (0 = off)
+    char delimiter = ',';       // Field separator of the rows
+    size_t groupColumn = 0;     // Conflation: field that, with the symbol, groups rows (the quote side)
+    std::string_view keepGroup; // Conflation: group value that is never conflated (trades)
+
+    bool enabled() const { return dedup || conflateNanos > 0; }
+};
+
+// Reduce stage between the k-way merge and the writer. Rows arrive in key order and are collected
+// one time bucket at a time (a bucket per timestamp when only deduplicating); once the bucket is
+// complete the surviving rows come back out in their merge order, so the output stays sorted.
+// A bucket holds a copy of its rows, which for a millisecond of market data is a few KiB.
+class RowReducer {
+public:
+    explicit RowReducer(const ReduceOptions& options);
+
+    // Whether 'key' belongs to the bucket being collected (always true between buckets)
+    bool accepts(const MergeKey& key) const;
+
+    // Adds the next row of the merge to the current bucket
+    void add(const MergeKey& key, std::string_view payload);
+
+    // Hands out the next surviving row of the collected bucket, valid until the next call; false
+    // once the bucket is done, after which add() starts the next one
+    bool next(MergeKey& key, std::string_view& payload);
+
+    // Rows dropped so far
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    struct Row {
+        MergeKey key;
+        size_t offset; // Of the payload in text_
+        size_t size;
+        uint32_t sameHash; // Earlier row of the bucket with the same hash, or NONE
+        bool superseded;
+    };
+    static const uint32_t NONE = UINT32_MAX;
+
+    ReduceOptions options_;
+    int64_t bucketNanos_;
+    int64_t bucket_ = 0;
+    std::vector<Row> rows_;
+    std::string text_;
+    size_t cursor_ = 0; // Next row next() looks at
+    std::unordered_map<uint64_t, uint32_t> lastByHash_;  // Dedup: last row per payload hash
+    std::unordered_map<uint64_t, uint32_t> lastByGroup_; // Conflation: last row per (symbol, group)
+    FieldDictionary groups_;
+    uint64_t dropped_ = 0;
+
+    std::string_view text(const Row& row) const { return std::string_view(text_).substr(row.offset, row.size); }
+    bool isDuplicate(const MergeKey& key, std::string_view payload, uint32_t index) const;
+    std::string_view groupField(std::string_view payload) const;
+};
+
+#endif // ROW_REDUCER_H
@@ -0,0 +1,20 @@
+// run_file.cpp
+#include "run_file.h"
+#include <cstring>
+
+void RunWriter::write(const MergeKey& key, std::string_view payload) {
+    RunRecordHeader header{key.timestamp, key.symbolId, static_cast<uint32_t>(payload.size())};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.write(payload.data(), payload.size());
+}
+
+bool RunReader::next(MergeKey& key, std::string_view& payload) {
+    std::string_view bytes;
+    if (!reader_.read(sizeof(RunRecordHeader), bytes)) return false;
+    RunRecordHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header)); // Copy out before the next read moves the buffer
+    if (!reader_.read(header.payloadLen, payload)) return false; // Truncated run
+    key.timestamp = header.timestamp;
+    key.symbolId = header.symbolId;
+    return true;
+}
@@ -0,0 +1,52 @@
+// run_file.h
+#ifndef RUN_FILE_H
+#define RUN_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "buffered_sink.h"
+#include "file_reader.h"
+#include "merge_key.h"
+
+// Binary intermediate ("run") format used for temp files. Each record is a fixed header
+// followed by the raw input row, so a run is re-read without any text parsing.
+// Runs are scratch files read back on the same machine, so fields use native byte order.
+struct RunRecordHeader {
+    int64_t timestamp;   // Nanoseconds since the epoch
+    uint32_t symbolId;   // Id in the merge's SymbolTable
+    uint32_t payloadLen; // Length of the row that follows
+};
+static_assert(sizeof(RunRecordHeader) == 16, "RunRecordHeader must be packed");
+
+// Appends records to a run file
+class RunWriter {
+public:
+    bool open(const std::string& path, size_t bufferSize = BufferedSink::DEFAULT_BUFFER_SIZE) {
+        return out_.open(path, bufferSize, true);
+    }
+    void write(const MergeKey& key, std::string_view payload);
+    bool close() { return out_.close(); }
+    const BufferedSink& sink() const { return out_; }
+
+    // Checksum of the run written, for the merge checkpoint (valid after close())
+    uint64_t checksum() const { return out_.checksum(); }
+
+private:
+    BufferedSink out_;
+};
+
+// Reads records back from a run file
+class RunReader {
+public:
+    bool open(const std::string& path, const ReadOptions& options = ReadOptions()) { return reader_.open(path, options); }
+
+    // Loads the next record; 'payload' stays valid until the next call
+    bool next(MergeKey& key, std::string_view& payload);
+    const FileReader& file() const { return reader_; }
+
+private:
+    FileReader reader_;
+};
+
+#endif // RUN_FILE_H
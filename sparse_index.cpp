@@ -0,0 +1,142 @@
+// sparse_index.cpp
+#include "sparse_index.h"
+#include "decompressor.h"
+#include "file_reader.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char MAGIC[8] = {'M', 'D', 'M', 'I', 'D', 'X', '0', '1'};
+
+struct IndexHeader {
+    char magic[8];
+    uint64_t fileSize;
+    int64_t fileMtime;
+    uint64_t interval;
+    uint64_t count;
+};
+
+} // namespace
+
+std::string SparseIndex::pathFor(const std::string& inputFile) {
+    return fs::path(std::string(withoutCompressionExtension(inputFile))).replace_extension(".idx").string();
+}
+
+std::string SparseIndex::tempPathFor(const std::string& path) {
+    static std::atomic<uint64_t> counter{0};
+#ifdef _WIN32
+    long pid = _getpid();
+#else
+    long pid = static_cast<long>(getpid());
+#endif
+    return path + ".tmp" + std::to_string(pid) + "." + std::to_string(counter.fetch_add(1));
+}
+
+bool SparseIndex::stat(const std::string& inputFile, uint64_t& size, int64_t& mtime) {
+    std::error_code error;
+    size = fs::file_size(inputFile, error);
+    if (error) return false;
+    auto time = fs::last_write_time(inputFile, error);
+    if (error) return false;
+    mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+bool SparseIndex::load(const std::string& inputFile) {
+    entries_.clear();
+    uint64_t size;
+    int64_t mtime;
+    if (!stat(inputFile, size, mtime)) return false;
+
+    std::FILE* file = std::fopen(pathFor(inputFile).c_str(), "rb");
+    if (!file) return false;
+    IndexHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+              header.fileSize == size && header.fileMtime == mtime && header.count <= size;
+    if (ok) {
+        entries_.resize(static_cast<size_t>(header.count));
+        ok = std::fread(entries_.data(), sizeof(IndexEntry), entries_.size(), file) == entries_.size();
+    }
+    std::fclose(file);
+    if (!ok) {
+        entries_.clear();
+        return false;
+    }
+    fileSize_ = size;
+    fileMtime_ = mtime;
+    interval_ = header.interval;
+    return true;
+}
+
+bool SparseIndex::save(const std::string& inputFile) const {
+    // Concurrent runs may build the same sidecar; whichever rename lands last wins, and both are valid
+    std::string path = pathFor(inputFile);
+    std::string temp = tempPathFor(path);
+    std::FILE* file = std::fopen(temp.c_str(), "wb");
+    if (!file) return false;
+    IndexHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.fileSize = fileSize_;
+    header.fileMtime = fileMtime_;
+    header.interval = interval_;
+    header.count = entries_.size();
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(entries_.data(), sizeof(IndexEntry), entries_.size(), file) == entries_.size();
+    ok = std::fclose(file) == 0 && ok;
+    std::error_code error;
+    if (ok) fs::rename(temp, path, error);
+    if (!ok || error) {
+        fs::remove(temp, error);
+        return false;
+    }
+    return true;
+}
+
+bool SparseIndex::build(const std::string& inputFile, RowTimestampParser parse, uint64_t interval) {
+    entries_.clear();
+    uint64_t size;
+    int64_t mtime;
+    FileReader reader;
+    if (!stat(inputFile, size, mtime) || !reader.open(inputFile)) return false;
+
+    std::vector<IndexEntry> entries;
+    std::string_view line;
+    reader.nextLine(line); // Header
+    uint64_t nextSample = 0;
+    for (uint64_t rowStart = reader.tell(); reader.nextLine(line); rowStart = reader.tell()) {
+        if (rowStart < nextSample) continue;
+        int64_t timestamp;
+        if (!parse(line, reader.lineComma(), timestamp)) continue;
+        entries.push_back({timestamp, rowStart});
+        nextSample = rowStart + std::max<uint64_t>(interval, 1);
+    }
+    assign(std::move(entries), size, mtime, interval);
+    return true;
+}
+
+void SparseIndex::assign(std::vector<IndexEntry> entries, uint64_t fileSize, int64_t fileMtime, uint64_t interval) {
+    entries_ = std::move(entries);
+    fileSize_ = fileSize;
+    fileMtime_ = fileMtime;
+    interval_ = interval;
+}
+
+uint64_t SparseIndex::seekOffset(int64_t from) const {
+    // Last sample older than 'from': every row before it is older too
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), from,
+                               [](const IndexEntry& entry, int64_t t) { return entry.timestamp < t; });
+    if (it == entries_.begin()) return entries_.empty() ? 0 : entries_.front().offset;
+    return std::prev(it)->offset;
+}
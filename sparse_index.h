@@ -0,0 +1,65 @@
+// sparse_index.h
+#ifndef SPARSE_INDEX_H
+#define SPARSE_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Parses the timestamp of a data row, given the offset of its first comma (see record_schema.h)
+using RowTimestampParser = bool (*)(std::string_view row, size_t firstComma, int64_t& timestamp);
+
+// One sample of an input file: a row start and that row's timestamp
+struct IndexEntry {
+    int64_t timestamp;
+    uint64_t offset;
+};
+
+// Sparse timestamp index of a sorted input file, kept as a "<SYMBOL>.idx" sidecar next to it.
+// Holds the first data row and then one row about every 'interval' bytes. The sidecar records
+// the size and modification time of the file it describes, and is ignored once either changes.
+// Like temp runs it is a local cache, so it is written in native byte order.
+class SparseIndex {
+public:
+    static const uint64_t DEFAULT_INTERVAL = 64 << 10;
+
+    // "<dir>/<SYMBOL>.idx" for "<dir>/<SYMBOL>.txt" (or a compressed "<SYMBOL>.txt.gz" / ".zst")
+    static std::string pathFor(const std::string& inputFile);
+
+    // Temp file to write 'path' through before renaming it into place, unique across processes and
+    // threads (pid and a counter), so concurrent writers of the same sidecar never share one
+    static std::string tempPathFor(const std::string& path);
+
+    // Current size and modification time of 'inputFile'; false if it cannot be examined
+    static bool stat(const std::string& inputFile, uint64_t& size, int64_t& mtime);
+
+    // Loads the sidecar of 'inputFile'; false if it is missing, damaged or stale
+    bool load(const std::string& inputFile);
+
+    // Writes the sidecar of 'inputFile' atomically (temp file + rename); false on failure
+    bool save(const std::string& inputFile) const;
+
+    // Scans 'inputFile' and samples it every 'interval' bytes; 'parse' is only called for sampled rows
+    bool build(const std::string& inputFile, RowTimestampParser parse, uint64_t interval = DEFAULT_INTERVAL);
+
+    // Adopts samples collected elsewhere (e.g. while merging) for a file of this size and mtime
+    void assign(std::vector<IndexEntry> entries, uint64_t fileSize, int64_t fileMtime, uint64_t interval);
+
+    // Offset of a row start at or before the first row with a timestamp >= 'from'; rows from there
+    // to that row span at most about one interval
+    uint64_t seekOffset(int64_t from) const;
+
+    bool empty() const { return entries_.empty(); }
+    const std::vector<IndexEntry>& entries() const { return entries_; }
+    uint64_t fileSize() const { return fileSize_; }
+    uint64_t interval() const { return interval_; }
+
+private:
+    std::vector<IndexEntry> entries_; // Ascending timestamps and offsets
+    uint64_t fileSize_ = 0;
+    int64_t fileMtime_ = 0;
+    uint64_t interval_ = DEFAULT_INTERVAL;
+};
+
+#endif // SPARSE_INDEX_H
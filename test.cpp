@@ -1,72 +1,735 @@
-// // test.cpp
-// #include "market_data_merger.h"
-// #include <iostream>
-// #include <fstream>
-// #include <cassert>
-// #include <filesystem>
-
-// namespace fs = std::filesystem;
-
-// void createTestFile(const std::string& path, const std::vector<std::string>& lines) {
-//     // Ensure the directory exists
-//     fs::path filePath(path);
-//     fs::create_directories(filePath.parent_path()); // Create parent directories if they don't exist
-
-//     std::ofstream file(path);
-//     if (!file.is_open()) {
-//         std::cerr << "Failed to open file for writing: " << path << std::endl;
-//         std::abort(); // Explicitly abort with a message
-//     }
-//     file << "Timestamp,Price,Size,Exchange,Type\n";
-//     for (const auto& line : lines) {
-//         file << line << "\n";
-//     }
-//     file.close();
-// }
-
-// void runTests() {
-//     // Create directories if they don't exist
-//     fs::create_directories("test_input");
-//     fs::create_directories("test_temp");
-
-//     // Create test input files
-//     createTestFile("test_input/MSFT.txt", {
-//         "2021-03-05 10:00:00.123,228.5,120,NYSE,Ask",
-//         "2021-03-05 10:00:00.133,228.5,120,NYSE,TRADE"
-//     });
-//     createTestFile("test_input/CSCO.txt", {
-//         "2021-03-05 10:00:00.123,46.14,120,NYSE_ARCA,Ask",
-//         "2021-03-05 10:00:00.130,46.13,120,NYSE,TRADE"
-//     });
-
-//     // Run merger
-//     MarketDataMerger merger("test_input", "test_temp", "test_output.txt");
-//     merger.merge();
-
-//     // Verify output
-//     std::ifstream outFile("test_output.txt");
-//     if (!outFile.is_open()) {
-//         std::cerr << "Failed to open test_output.txt for reading" << std::endl;
-//         std::abort();
-//     }
-//     std::string line;
-//     std::vector<std::string> expected = {
-//         "Symbol,Timestamp,Price,Size,Exchange,Type",
-//         "CSCO,2021-03-05 10:00:00.123,46.14,120,NYSE_ARCA,Ask",
-//         "MSFT,2021-03-05 10:00:00.123,228.5,120,NYSE,Ask",
-//         "CSCO,2021-03-05 10:00:00.130,46.13,120,NYSE,TRADE",
-//         "MSFT,2021-03-05 10:00:00.133,228.5,120,NYSE,TRADE"
-//     };
-//     size_t i = 0;
-//     while (std::getline(outFile, line)) {
-//         assert(i < expected.size() && line == expected[i]);
-//         ++i;
-//     }
-//     assert(i == expected.size());
-//     std::cout << "All tests passed!" << std::endl;
-// }
-
-// int main() {
-//     runTests();
-//     return 0;
-// }
\ No newline at end of file
+// test.cpp
+// merger_test: checks every merge engine against golden output on tricky inputs, then times
+// micro-benchmarks of the hot paths and fails when one falls too far below its stored baseline.
+#include "append_state.h"
+#include "buffered_sink.h"
+#include "decompressor.h"
+#include "file_reader.h"
+#include "line_scanner.h"
+#include "market_data_merger.h"
+#include "merge_key.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const HEADER = "Timestamp,Price,Size,Exchange,Type";
+const size_t MANY_FILES = 620; // More than MAX_FILES_OPEN (500): every engine goes through binary temp runs
+const double DEFAULT_THRESHOLD = 0.25;
+const char* const WORK_DIR_MARKER = ".merger_test"; // Marks a work directory this program created and may wipe
+
+// A named merger configuration to check, as in bench.cpp
+struct Engine {
+    const char* name;
+    MergeOptions options;
+};
+
+std::vector<Engine> allEngines() {
+    std::vector<Engine> engines;
+    MergeOptions options;
+    engines.push_back({"loser-tree", options});
+
+    options = MergeOptions();
+    options.kernel = MergeKernel::Heap;
+    engines.push_back({"heap", options});
+
+    options = MergeOptions();
+    options.io = IoMode::Mmap;
+    engines.push_back({"mmap", options});
+
+    options = MergeOptions();
+    options.threads = 4;
+    engines.push_back({"parallel", options});
+
+    options = MergeOptions();
+    options.partitions = 4;
+    engines.push_back({"partitioned", options});
+
+    options = MergeOptions();
+    options.prefetchThreads = 2;
+    engines.push_back({"prefetch", options});
+    return engines;
+}
+
+// Inputs to merge and the output every engine must produce from them
+struct Dataset {
+    std::string name;
+    std::string dir;
+    std::vector<std::string> golden; // Output lines, header included
+    bool multiPass;                  // Too many inputs for one merge
+};
+
+void writeInput(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+std::string symbolName(size_t index) {
+    std::string name(4, 'A');
+    for (size_t pos = name.size(); pos-- > 0 && index > 0; index /= 26) {
+        name[pos] = static_cast<char>('A' + index % 26);
+    }
+    return name;
+}
+
+std::string timestamp(int64_t millis) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "2021-03-05 10:%02d:%02d.%03d", static_cast<int>(millis / 60000 % 60),
+                  static_cast<int>(millis / 1000 % 60), static_cast<int>(millis % 1000));
+    return text;
+}
+
+// The expected merge, worked out independently of the merger: every well-formed data row, stably
+// sorted by (timestamp, symbol) so rows of one symbol and timestamp keep their file order
+std::vector<std::string> referenceMerge(const std::string& dir) {
+    struct Row {
+        int64_t timestamp;
+        std::string symbol;
+        std::string text;
+    };
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() == ".txt") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    std::vector<Row> rows;
+    for (const auto& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        std::string line;
+        bool header = true;
+        while (std::getline(in, line)) {
+            if (header) {
+                header = false;
+                continue;
+            }
+            size_t comma = line.find(',');
+            int64_t nanos;
+            if (comma == std::string::npos || !parseTimestamp(std::string_view(line).substr(0, comma), nanos)) continue;
+            rows.push_back({nanos, file.stem().string(), line});
+        }
+    }
+    std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        return a.timestamp < b.timestamp || (a.timestamp == b.timestamp && a.symbol < b.symbol);
+    });
+    std::vector<std::string> lines{std::string("Symbol,") + HEADER};
+    for (const Row& row : rows) lines.push_back(row.symbol + "," + row.text);
+    return lines;
+}
+
+// The repository's sample, with the output the original test expected
+Dataset sampleDataset() {
+    Dataset data;
+    data.name = "sample";
+    data.dir = "test_input";
+    data.golden = {
+        "Symbol,Timestamp,Price,Size,Exchange,Type",
+        "CSCO,2021-03-05 10:00:00.123,46.14,120,NYSE_ARCA,Ask",
+        "MSFT,2021-03-05 10:00:00.123,228.5,120,NYSE,Ask",
+        "CSCO,2021-03-05 10:00:00.130,46.13,120,NYSE,TRADE",
+        "MSFT,2021-03-05 10:00:00.133,228.5,120,NYSE,TRADE"
+    };
+    data.multiPass = false;
+    return data;
+}
+
+// Edge cases: every symbol quoting at the same instants, repeated timestamps within a symbol, an
+// empty file, a header-only file, a last row without a newline and rows that must be skipped
+Dataset edgeCaseDataset(const std::string& workDir) {
+    Dataset data;
+    data.name = "edge-cases";
+    data.dir = workDir + "/edge_cases";
+    fs::create_directories(data.dir);
+    for (size_t s = 0; s < 40; ++s) {
+        std::string text = std::string(HEADER) + "\n";
+        for (int64_t t = 0; t < 12; ++t) {
+            // Every third instant twice, told apart by size: file order must survive the merge
+            for (size_t copy = 0; copy < (t % 3 == 0 ? 2u : 1u); ++copy) {
+                text += timestamp(t * 5) + "," + std::to_string(10 + s) + "." + std::to_string(t) + "," +
+                        std::to_string(100 + copy) + ",NYSE," + (t % 4 == 0 ? "TRADE" : "Bid") + "\n";
+            }
+        }
+        writeInput(data.dir + "/" + symbolName(s) + ".txt", text);
+    }
+    writeInput(data.dir + "/EMPTY.txt", "");
+    writeInput(data.dir + "/HEAD.txt", std::string(HEADER) + "\n");
+    writeInput(data.dir + "/NONL.txt", std::string(HEADER) + "\n" + timestamp(5) + ",1.5,7,BATS,Ask\n" +
+                                           timestamp(30) + ",1.6,8,BATS,TRADE");
+    writeInput(data.dir + "/SKIP.txt", std::string(HEADER) + "\n" + timestamp(10) + ",2.5,1,NSX,Ask\n" +
+                                           "no comma on this line\n" + "not a time,2.6,1,NSX,Bid\n" + timestamp(10) +
+                                           ",2.7,1,NSX,TRADE\n");
+    data.golden = referenceMerge(data.dir);
+    data.multiPass = false;
+    return data;
+}
+
+// More inputs than MAX_FILES_OPEN, with timestamps drawn from a narrow range so ties across
+// symbols are common, and a few inputs without a single row
+Dataset manyFilesDataset(const std::string& workDir) {
+    Dataset data;
+    data.name = "many-files";
+    data.dir = workDir + "/many_files";
+    fs::create_directories(data.dir);
+    std::mt19937_64 rng(7);
+    for (size_t s = 0; s < MANY_FILES; ++s) {
+        std::string text = std::string(HEADER) + "\n";
+        size_t rows = s % 50 == 0 ? 0 : 1 + rng() % 30;
+        int64_t millis = static_cast<int64_t>(rng() % 200);
+        for (size_t r = 0; r < rows; ++r) {
+            millis += static_cast<int64_t>(rng() % 3); // 0 repeats the previous timestamp
+            text += timestamp(millis) + "," + std::to_string(rng() % 1000) + ".25," + std::to_string(1 + rng() % 500) +
+                    ",NASDAQ," + (rng() % 3 == 0 ? "TRADE" : "Ask") + "\n";
+        }
+        writeInput(data.dir + "/" + symbolName(s) + ".txt", text);
+    }
+    data.golden = referenceMerge(data.dir);
+    data.multiPass = true;
+    return data;
+}
+
+// Compares 'outputFile' line by line with 'golden'; empty if they match, else what differs
+std::string compareOutput(const std::string& outputFile, const std::vector<std::string>& golden) {
+    std::ifstream in(outputFile, std::ios::binary);
+    std::string line;
+    size_t i = 0;
+    for (; std::getline(in, line); ++i) {
+        if (i >= golden.size()) return "extra line " + std::to_string(i + 1) + ": " + line;
+        if (line != golden[i]) return "line " + std::to_string(i + 1) + " is \"" + line + "\", expected \"" + golden[i] + "\"";
+    }
+    if (i < golden.size()) return "missing line " + std::to_string(i + 1) + ": " + golden[i];
+    return std::string();
+}
+
+// Prints the verdict of one check; true if it passed
+bool report(const std::string& check, const char* engine, const std::string& failure) {
+    std::printf("%-4s %-18s %-12s %s\n", failure.empty() ? "ok" : "FAIL", check.c_str(), engine, failure.c_str());
+    return failure.empty();
+}
+
+// Empty temp directory and no output file yet, under 'workDir'
+void resetRun(const std::string& tempDir, const std::string& outputFile) {
+    fs::remove_all(tempDir);
+    fs::create_directories(tempDir);
+    fs::remove(outputFile);
+}
+
+// Merges 'data' with 'engine' and compares the output line by line; prints its verdict
+bool checkEngine(const Dataset& data, const Engine& engine, const std::string& workDir) {
+    std::string tempDir = workDir + "/temp";
+    std::string outputFile = workDir + "/output.txt";
+    resetRun(tempDir, outputFile);
+    MergeOptions options = engine.options;
+    options.useIndex = false;    // Sidecars and the manifest would change the inputs' directory
+    options.useManifest = false; // between engines; every engine sees the same files
+    MarketDataMerger merger(data.dir, tempDir, outputFile, options);
+    bool merged = merger.merge();
+
+    std::string failure = merged ? compareOutput(outputFile, data.golden) : "merge() failed";
+    if (failure.empty() && data.multiPass && merger.stats().passes < 2) failure = "merged in a single pass";
+    if (failure.empty() && !fs::is_empty(tempDir)) failure = "left files in the temp directory";
+    return report(data.name, engine.name, failure);
+}
+
+// Text of an input up to its first data row at or after 'until': what a feed had written by then
+std::string writtenBefore(const std::string& text, int64_t until) {
+    size_t pos = text.find('\n');
+    if (pos == std::string::npos) return text; // Nothing but (part of) the header
+    for (++pos; pos < text.size();) {
+        size_t end = text.find('\n', pos);
+        std::string_view line(text.data() + pos, (end == std::string::npos ? text.size() : end) - pos);
+        size_t comma = line.find(',');
+        int64_t nanos;
+        if (comma != std::string::npos && parseTimestamp(line.substr(0, comma), nanos) && nanos >= until) break;
+        pos = end == std::string::npos ? text.size() : end + 1;
+    }
+    return text.substr(0, pos);
+}
+
+std::string readInput(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// --append with 'engine': the inputs hold their rows before the last quarter of the timestamps
+// for the first run, then grow to the full dataset for a second run, which must add only the new
+// rows and match the golden output. Last rows get their newline, as --append waits for it.
+bool checkAppend(const Dataset& data, const Engine& engine, const std::string& workDir) {
+    std::vector<int64_t> timestamps;
+    for (size_t i = 1; i < data.golden.size(); ++i) {
+        std::string_view row = std::string_view(data.golden[i]).substr(data.golden[i].find(',') + 1);
+        int64_t nanos;
+        if (parseTimestamp(row.substr(0, row.find(',')), nanos)) timestamps.push_back(nanos);
+    }
+    std::sort(timestamps.begin(), timestamps.end());
+    int64_t until = timestamps.empty() ? 0 : timestamps[timestamps.size() * 3 / 4];
+
+    std::string dir = workDir + "/append";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::map<std::string, std::string> inputs; // File name -> full text
+    for (const auto& entry : fs::directory_iterator(data.dir)) {
+        if (entry.path().extension() != ".txt") continue;
+        std::string text = readInput(entry.path());
+        if (!text.empty() && text.back() != '\n') text += '\n';
+        inputs[entry.path().filename().string()] = text;
+        writeInput(dir + "/" + entry.path().filename().string(), writtenBefore(text, until));
+    }
+    std::string tempDir = workDir + "/temp";
+    std::string outputFile = workDir + "/output.txt";
+    resetRun(tempDir, outputFile);
+    MergeOptions options = engine.options;
+    options.append = true;
+    options.useIndex = false;
+    options.useManifest = false;
+
+    std::string failure;
+    if (!MarketDataMerger(dir, tempDir, outputFile, options).merge()) failure = "first merge() failed";
+    if (failure.empty()) {
+        failure = compareOutput(outputFile, referenceMerge(dir));
+        if (!failure.empty()) failure = "first run: " + failure;
+    }
+    for (const auto& input : inputs) writeInput(dir + "/" + input.first, input.second);
+    MarketDataMerger merger(dir, tempDir, outputFile, options);
+    if (failure.empty() && !merger.merge()) failure = "second merge() failed";
+    if (failure.empty()) failure = compareOutput(outputFile, data.golden);
+    // A full merge writes every row at least once
+    if (failure.empty() && merger.stats().recordsMerged >= data.golden.size() - 1) failure = "merged everything again";
+    if (failure.empty() && !fs::is_empty(tempDir)) failure = "left files in the temp directory";
+    fs::remove(AppendState::pathFor(outputFile));
+    return report(data.name + " append", engine.name, failure);
+}
+
+// A group pass that cannot write its run must fail the merge instead of handing a truncated set of
+// runs to the next pass; the blocked run never takes its final name. --resume then redoes only
+// that group.
+bool checkFailedPass(const Dataset& data, const std::string& workDir) {
+    std::string tempDir = workDir + "/temp";
+    std::string outputFile = workDir + "/output.txt";
+    resetRun(tempDir, outputFile);
+    fs::create_directories(tempDir + "/temp_0_1.run.partial"); // The group's run cannot be opened for writing
+    MergeOptions options;
+    options.useIndex = false;
+    options.useManifest = false;
+    MarketDataMerger merger(data.dir, tempDir, outputFile, options);
+
+    std::string failure;
+    if (merger.merge()) failure = "merge() succeeded without run 2 of pass 1";
+    else if (fs::exists(tempDir + "/temp_0_1.run")) failure = "the failed run was renamed into place";
+    else if (fs::exists(outputFile) && fs::file_size(outputFile) > 0) failure = "wrote output from a failed pass";
+    bool ok = report("failed-pass", "loser-tree", failure);
+
+    fs::remove_all(tempDir + "/temp_0_1.run.partial");
+    options.resume = true;
+    MarketDataMerger resumed(data.dir, tempDir, outputFile, options);
+    failure = resumed.merge() ? compareOutput(outputFile, data.golden) : "merge() failed";
+    // Without the reused run, both passes would write every row
+    uint64_t rows = data.golden.size() - 1;
+    if (failure.empty() && resumed.stats().recordsMerged >= 2 * rows) failure = "redid the completed group";
+    if (failure.empty() && !fs::is_empty(tempDir)) failure = "left files in the temp directory";
+    ok = report("resume", "loser-tree", failure) && ok;
+
+    // stream() tells the same failure apart from an empty merge
+    resetRun(tempDir, outputFile);
+    fs::create_directories(tempDir + "/temp_0_1.run.partial");
+    MergeStream stream = merger.stream();
+    failure.clear();
+    if (!stream.failed()) failure = "stream() did not fail";
+    else if (stream.symbols().size() > 0 || stream.begin() != stream.end()) failure = "a failed stream has records";
+    fs::remove_all(tempDir + "/temp_0_1.run.partial");
+    return report("failed-pass", "stream", failure) && ok;
+}
+
+// A reader stops at its end offset, whatever the file has grown to since the size was taken, in
+// every I/O mode; --append so never takes a row twice, nor splits one a feed is still writing
+bool checkAppendBound(const std::string& workDir) {
+    std::string path = workDir + "/bounded.txt";
+    std::string text = std::string(HEADER) + "\n" + timestamp(100) + ",1.5,10,NYSE,Ask\n";
+    ThreadPool prefetchPool(1);
+    std::string failure;
+    for (int mode = 0; mode < 3 && failure.empty(); ++mode) {
+        writeInput(path, text + timestamp(200) + ",1.5,10,NYSE,Ask\n"); // Grew after its size was taken
+        ReadOptions options;
+        options.mode = mode == 1 ? IoMode::Mmap : IoMode::Stream;
+        if (mode == 2) options.prefetchPool = &prefetchPool;
+        options.endOffset = text.size();
+        FileReader reader;
+        size_t lines = 0;
+        std::string_view line;
+        if (reader.open(path, options)) {
+            while (reader.nextLine(line)) ++lines;
+        }
+        if (lines != 2 || reader.tell() != text.size()) {
+            failure = std::to_string(lines) + " lines read to offset " + std::to_string(reader.tell()) + " in mode " +
+                      std::to_string(mode) + ", expected 2 to " + std::to_string(text.size());
+        }
+    }
+    bool ok = report("append", "end-offset", failure);
+
+    // The last row of AAAA is half written during the first run and completed before the second
+    std::string dir = workDir + "/append_bound";
+    std::string tempDir = workDir + "/temp";
+    std::string outputFile = workDir + "/output.txt";
+    fs::create_directories(dir);
+    writeInput(dir + "/AAAA.txt", std::string(HEADER) + "\n" + timestamp(100) + ",1.5,10,NYSE,Ask\n" + timestamp(300) +
+                                      ",1.5,20,NYSE,Bid\n" + timestamp(400) + ",1.");
+    writeInput(dir + "/BBBB.txt", std::string(HEADER) + "\n" + timestamp(200) + ",2.5,10,NYSE,Ask\n");
+    resetRun(tempDir, outputFile);
+    MergeOptions options;
+    options.append = true;
+    options.useIndex = false;
+    options.useManifest = false;
+    failure.clear();
+    if (!MarketDataMerger(dir, tempDir, outputFile, options).merge()) failure = "first merge() failed";
+    {
+        std::ofstream(dir + "/AAAA.txt", std::ios::binary | std::ios::app) << "5,30,NYSE,Ask\n" << timestamp(500) << ",1.5,40,NYSE,Ask\n";
+        std::ofstream(dir + "/BBBB.txt", std::ios::binary | std::ios::app) << timestamp(450) << ",2.5,20,NYSE,Ask\n";
+    }
+    if (failure.empty() && !MarketDataMerger(dir, tempDir, outputFile, options).merge()) failure = "second merge() failed";
+    if (failure.empty()) failure = compareOutput(outputFile, referenceMerge(dir));
+    fs::remove(AppendState::pathFor(outputFile));
+    return report("append", "half-row", failure) && ok;
+}
+
+// An output merged over all symbols is not extended by a run with --symbols: the rows of the other
+// symbols must go, so the run merges everything instead of keeping them
+bool checkAppendSymbols(const std::string& workDir) {
+    std::string dir = workDir + "/append_symbols";
+    std::string onlyDir = workDir + "/append_symbols_only";
+    std::string tempDir = workDir + "/temp";
+    std::string outputFile = workDir + "/output.txt";
+    fs::create_directories(dir);
+    fs::create_directories(onlyDir);
+    writeInput(dir + "/AAAA.txt", std::string(HEADER) + "\n" + timestamp(100) + ",1.5,10,NYSE,Ask\n");
+    writeInput(dir + "/BBBB.txt", std::string(HEADER) + "\n" + timestamp(200) + ",2.5,10,NYSE,Ask\n");
+    resetRun(tempDir, outputFile);
+    MergeOptions options;
+    options.append = true;
+    options.useIndex = false;
+    options.useManifest = false;
+    std::string failure;
+    if (!MarketDataMerger(dir, tempDir, outputFile, options).merge()) failure = "first merge() failed";
+    {
+        std::ofstream(dir + "/AAAA.txt", std::ios::binary | std::ios::app) << timestamp(300) << ",1.5,20,NYSE,Bid\n";
+        std::ofstream(dir + "/BBBB.txt", std::ios::binary | std::ios::app) << timestamp(400) << ",2.5,20,NYSE,Bid\n";
+    }
+    fs::copy_file(dir + "/AAAA.txt", onlyDir + "/AAAA.txt", fs::copy_options::overwrite_existing);
+    options.symbols = {"AAAA"};
+    if (failure.empty() && !MarketDataMerger(dir, tempDir, outputFile, options).merge()) failure = "second merge() failed";
+    if (failure.empty()) failure = compareOutput(outputFile, referenceMerge(onlyDir));
+    fs::remove(AppendState::pathFor(outputFile));
+    return report("append", "symbols", failure);
+}
+
+// Timestamps of days that do not exist, or beyond what int64 nanoseconds hold, are rejected
+bool checkTimestampParsing() {
+    const char* const valid[] = {"2024-02-29 10:00:00.000", "2021-12-31 23:59:59", "1678-01-01 00:00:00",
+                                 "2261-12-31 23:59:59.999999999"};
+    const char* const invalid[] = {"2021-02-29 10:00:00.000", "2021-02-31 10:00:00", "2021-04-31 10:00:00.000",
+                                   "1900-02-29 10:00:00", "2262-04-12 00:00:00.000", "9999-12-31 23:59:59",
+                                   "1677-01-01 00:00:00.000", "2021-13-01 10:00:00"};
+    std::string failure;
+    int64_t nanos;
+    for (const char* text : valid) {
+        if (failure.empty() && !parseTimestamp(text, nanos)) failure = std::string("rejected ") + text;
+    }
+    for (const char* text : invalid) {
+        if (failure.empty() && parseTimestamp(text, nanos)) failure = std::string("accepted ") + text;
+    }
+    return report("timestamps", "parse", failure);
+}
+
+// Typed mode leaves out rows it cannot represent (a 7-decimal price, a non-numeric size), and
+// must count every one of them
+bool checkTypedRejects(const std::string& workDir) {
+    std::string dir = workDir + "/typed_rejects";
+    std::string tempDir = workDir + "/temp";
+    std::string outputFile = workDir + "/output.txt";
+    fs::create_directories(dir);
+    writeInput(dir + "/AAAA.txt", std::string(HEADER) + "\n" + timestamp(100) + ",1.5,10,NYSE,Ask\n" + timestamp(200) +
+                                      ",1.1234567,10,NYSE,Ask\n" + timestamp(300) + ",1.5,abc,NYSE,Bid\n");
+    writeInput(dir + "/BBBB.txt", std::string(HEADER) + "\n" + timestamp(150) + ",2.5,10,NYSE,Ask\n");
+    resetRun(tempDir, outputFile);
+    MergeOptions options;
+    options.typed = true;
+    options.useIndex = false;
+    options.useManifest = false;
+    MarketDataMerger merger(dir, tempDir, outputFile, options);
+    merger.merge();
+
+    std::string failure = compareOutput(outputFile, {std::string("Symbol,") + HEADER,
+                                                     "AAAA," + timestamp(100) + ",1.5,10,NYSE,Ask",
+                                                     "BBBB," + timestamp(150) + ",2.5,10,NYSE,Ask"});
+    if (failure.empty() && merger.stats().recordsRejected != 2) {
+        failure = "counted " + std::to_string(merger.stats().recordsRejected) + " rejected rows, expected 2";
+    }
+    bool ok = report("rejects", "typed", failure);
+
+    // stream() hands out the same records and counts the same rows
+    size_t records = 0;
+    MergeStream stream = merger.stream();
+    for (const RecordBatch& batch : stream) records += batch.size();
+    failure.clear();
+    if (records != 2 || stream.rejected() != 2) {
+        failure = std::to_string(records) + " records and " + std::to_string(stream.rejected()) +
+                  " rejected rows, expected 2 and 2";
+    }
+    return report("rejects", "stream", failure) && ok;
+}
+
+// Shortest of 'repetitions' timed runs of 'body', in seconds
+template <typename Body>
+double bestTime(size_t repetitions, Body&& body) {
+    double best = 1e300;
+    for (size_t i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// Rows like the inputs', for the scanner and writer benchmarks
+std::string sampleRows(size_t bytes) {
+    std::mt19937_64 rng(11);
+    std::string text;
+    text.reserve(bytes + 64);
+    int64_t millis = 0;
+    while (text.size() < bytes) {
+        millis += static_cast<int64_t>(rng() % 3);
+        text += timestamp(millis % 3600000) + "," + std::to_string(rng() % 500) + ".17," + std::to_string(rng() % 1000) +
+                ",NYSE_ARCA,Bid\n";
+    }
+    return text;
+}
+
+// One micro-benchmark result; higher is better
+struct Measurement {
+    std::string name;
+    double throughput;
+    const char* unit;
+};
+
+std::vector<Measurement> runBenchmarks(const std::string& workDir) {
+    const size_t repetitions = 5;
+    std::vector<Measurement> results;
+    volatile size_t sink = 0; // Keeps the measured loops from being optimized away
+
+    // MergeKey ordering, the comparison every kernel step makes; about half the pairs tie on timestamp
+    {
+        std::mt19937_64 rng(3);
+        std::vector<MergeKey> keys(1 << 20);
+        for (MergeKey& key : keys) key = MergeKey{static_cast<int64_t>(rng() % 1024), static_cast<uint32_t>(rng() % 64)};
+        const size_t rounds = 32;
+        double seconds = bestTime(repetitions, [&] {
+            size_t less = 0;
+            for (size_t round = 1; round <= rounds; ++round) {
+                for (size_t i = 0; i + rounds < keys.size(); ++i) less += keys[i] < keys[i + round];
+            }
+            sink = sink + less;
+        });
+        results.push_back({"comparator", static_cast<double>(rounds * (keys.size() - rounds)) / seconds / 1e6, "Mcmp/s"});
+    }
+
+    // Timestamp parsing of every key column
+    {
+        std::vector<std::string> stamps;
+        for (int64_t millis = 0; millis < (1 << 18); ++millis) stamps.push_back(timestamp(millis * 7 % 3600000));
+        double seconds = bestTime(repetitions, [&] {
+            int64_t sum = 0;
+            for (const std::string& stamp : stamps) {
+                int64_t nanos;
+                if (parseTimestamp(stamp, nanos)) sum += nanos;
+            }
+            sink = sink + static_cast<size_t>(sum);
+        });
+        results.push_back({"timestamp-parse", static_cast<double>(stamps.size()) / seconds / 1e6, "Mrows/s"});
+    }
+
+    std::string rows = sampleRows(32 << 20);
+    double rowsMiB = static_cast<double>(rows.size()) / (1024.0 * 1024.0);
+
+    // Newline and first-comma scan over merged-size input
+    {
+        std::vector<LineBreak> breaks;
+        breaks.reserve(rows.size() / 32);
+        double seconds = bestTime(repetitions, [&] {
+            breaks.clear();
+            size_t pending = NO_COMMA;
+            scanLines(rows.data(), 0, rows.size(), pending, breaks);
+            sink = sink + breaks.size();
+        });
+        results.push_back({"line-scanner", rowsMiB / seconds, "MiB/s"});
+    }
+
+    // Output writer: rows handed over one at a time, as the merge writes them
+    {
+        std::string path = workDir + "/writer.bin";
+        std::vector<size_t> starts{0};
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (rows[i] == '\n') starts.push_back(i + 1);
+        }
+        double seconds = bestTime(repetitions, [&] {
+            BufferedSink out;
+            if (!out.open(path)) return;
+            for (size_t i = 0; i + 1 < starts.size(); ++i) out.write(rows.data() + starts[i], starts[i + 1] - starts[i]);
+            out.close();
+        });
+        fs::remove(path);
+        results.push_back({"writer", rowsMiB / seconds, "MiB/s"});
+    }
+    return results;
+}
+
+// Baselines are "<benchmark> <throughput>" lines; other lines are ignored
+std::map<std::string, double> loadBaselines(const std::string& path) {
+    std::map<std::string, double> baselines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        double value;
+        if (line.empty() || line[0] == '#' || !(fields >> name >> value)) continue;
+        baselines[name] = value;
+    }
+    return baselines;
+}
+
+bool saveBaselines(const std::string& path, const std::map<std::string, double>& baselines) {
+    std::ofstream out(path);
+    out << "# merger_test micro-benchmark baselines (throughput, higher is better); rewrite with --update-baselines\n";
+    for (const auto& baseline : baselines) out << baseline.first << " " << baseline.second << "\n";
+    return static_cast<bool>(out);
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [--golden-only | --bench-only] [--engines a,b,...] [--baselines FILE] [--update-baselines]"
+                 " [--threshold PCT] [--work-dir DIR] [--keep-data]\n"
+              << "Engines:";
+    for (const auto& engine : allEngines()) std::cerr << " " << engine.name;
+    std::cerr << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool golden = true;
+    bool bench = true;
+    std::string engineList;
+    std::string baselineFile = "test_baselines.txt";
+    bool updateBaselines = false;
+    double threshold = DEFAULT_THRESHOLD;
+    std::string workDir = "test_data";
+    bool keepData = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--golden-only") bench = false;
+            else if (arg == "--bench-only") golden = false;
+            else if (arg == "--engines" && hasValue) engineList = argv[++i];
+            else if (arg == "--baselines" && hasValue) baselineFile = argv[++i];
+            else if (arg == "--update-baselines") updateBaselines = true;
+            else if (arg == "--threshold" && hasValue) threshold = std::stod(argv[++i]) / 100;
+            else if (arg == "--work-dir" && hasValue) workDir = argv[++i];
+            else if (arg == "--keep-data") keepData = true;
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Engine> engines;
+    for (const auto& engine : allEngines()) {
+        std::string name = std::string(",") + engine.name + ",";
+        if (engineList.empty() || ("," + engineList + ",").find(name) != std::string::npos) engines.push_back(engine);
+    }
+    if ((!golden && !bench) || engines.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // The work directory is wiped, so it must be new or one an earlier run left (--keep-data)
+    if (fs::exists(workDir) && !fs::exists(fs::path(workDir) / WORK_DIR_MARKER)) {
+        std::cerr << workDir << " exists and was not created by merger_test; pass a new --work-dir" << std::endl;
+        return 1;
+    }
+    fs::remove_all(workDir);
+    fs::create_directories(workDir);
+    writeInput((fs::path(workDir) / WORK_DIR_MARKER).string(), "");
+    size_t failures = 0;
+
+    if (golden) {
+        std::vector<Dataset> datasets{sampleDataset(), edgeCaseDataset(workDir), manyFilesDataset(workDir)};
+        for (const auto& data : datasets) {
+            for (const auto& engine : engines) {
+                if (!checkEngine(data, engine, workDir)) ++failures;
+            }
+        }
+        for (const auto& data : datasets) {
+            for (const auto& engine : engines) {
+                if (!checkAppend(data, engine, workDir)) ++failures;
+            }
+        }
+        if (!checkTimestampParsing()) ++failures;
+        if (!checkTypedRejects(workDir)) ++failures;
+        if (!checkFailedPass(datasets[2], workDir)) ++failures;
+        if (!checkAppendBound(workDir)) ++failures;
+        if (!checkAppendSymbols(workDir)) ++failures;
+    }
+
+    if (bench) {
+        std::map<std::string, double> baselines = loadBaselines(baselineFile);
+        bool recorded = false;
+        std::printf("%-4s %-16s %12s %12s %8s\n", "", "benchmark", "throughput", "baseline", "change");
+        for (const Measurement& result : runBenchmarks(workDir)) {
+            auto baseline = baselines.find(result.name);
+            bool regressed = !updateBaselines && baseline != baselines.end() &&
+                             result.throughput < baseline->second * (1 - threshold);
+            if (regressed) ++failures;
+            if (baseline == baselines.end() || updateBaselines) {
+                std::printf("%-4s %-16s %12.1f %12s %8s  %s\n", "ok", result.name.c_str(), result.throughput, "-", "-",
+                            result.unit);
+                baselines[result.name] = result.throughput;
+                recorded = true;
+                continue;
+            }
+            std::printf("%-4s %-16s %12.1f %12.1f %+7.1f%%  %s\n", regressed ? "FAIL" : "ok", result.name.c_str(),
+                        result.throughput, baseline->second, (result.throughput / baseline->second - 1) * 100,
+                        result.unit);
+        }
+        // A missing baseline is recorded by the first run on a machine; --update-baselines replaces them all
+        if (recorded) {
+            if (saveBaselines(baselineFile, baselines)) std::cout << "Baselines written to " << baselineFile << std::endl;
+            else std::cerr << "Failed to write " << baselineFile << std::endl;
+        }
+    }
+
+    if (!keepData) fs::remove_all(workDir);
+    if (failures > 0) {
+        std::cout << failures << " check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed." << std::endl;
+    return 0;
+}
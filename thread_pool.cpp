@@ -0,0 +1,85 @@
+// thread_pool.cpp
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    numThreads = std::max<size_t>(numThreads, 1);
+    workers_.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    taskReady_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push(std::move(task));
+        ++pending_;
+    }
+    taskReady_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    allDone_.wait(lock, [this] { return pending_ == 0; });
+    if (firstError_) {
+        std::exception_ptr error = firstError_;
+        firstError_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            taskReady_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) return; // Stopping and drained
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+
+        try {
+            task();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!firstError_) firstError_ = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) allDone_.notify_all();
+    }
+}
+
+DescriptorBudget::DescriptorBudget(size_t limit)
+    : available_(limit), limit_(limit) {
+}
+
+size_t DescriptorBudget::acquire(size_t count) {
+    count = std::min(count, limit_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [this, count] { return available_ >= count; });
+    available_ -= count;
+    return count;
+}
+
+void DescriptorBudget::release(size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        available_ += count;
+    }
+    released_.notify_all();
+}
@@ -0,0 +1,73 @@
+// thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads executing submitted tasks in FIFO order
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished; rethrows the first task exception
+    void wait();
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable taskReady_;
+    std::condition_variable allDone_;
+    size_t pending_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr firstError_;
+
+    void workerLoop();
+};
+
+// Counting semaphore bounding the number of file descriptors held across all workers
+class DescriptorBudget {
+public:
+    explicit DescriptorBudget(size_t limit);
+
+    // Blocks until 'count' descriptors are available (a request above the limit is clamped to it)
+    size_t acquire(size_t count);
+    void release(size_t count);
+
+private:
+    size_t available_;
+    size_t limit_;
+    std::mutex mutex_;
+    std::condition_variable released_;
+};
+
+// RAII holder for descriptors taken from a DescriptorBudget
+class DescriptorLease {
+public:
+    DescriptorLease(DescriptorBudget& budget, size_t count)
+        : budget_(budget), count_(budget.acquire(count)) {
+    }
+    ~DescriptorLease() { budget_.release(count_); }
+
+    DescriptorLease(const DescriptorLease&) = delete;
+    DescriptorLease& operator=(const DescriptorLease&) = delete;
+
+private:
+    DescriptorBudget& budget_;
+    size_t count_;
+};
+
+#endif // THREAD_POOL_H